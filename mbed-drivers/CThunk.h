@@ -26,6 +26,9 @@
 #ifndef __CTHUNK_H__
 #define __CTHUNK_H__
 
+#include <stdint.h>
+#include <stddef.h>
+
 #define CTHUNK_ADDRESS 1
 
 #if defined(TARGET_LIKE_CORTEX_M3) || defined(TARGET_LIKE_CORTEX_M4)
@@ -59,6 +62,16 @@
                              m_thunk.code[2] = 0xBD1F4798; \
                          } while (0)
 
+#elif defined(TARGET_LIKE_POSIX)
+/*
+* Host builds can't generate code, so each thunk takes one of a static table
+* of entry functions instead, which calls the thunk it is bound to.
+* The table has YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES entries, see
+* source/CThunk.cpp. As the HAL passes handlers in uint32_t, the code
+* must be linked below 4GB (non-PIE executables).
+*/
+#define CTHUNK_HOST 1
+
 #else
 #error "Target is not currently suported."
 #endif
@@ -66,6 +79,19 @@
 /* IRQ/Exception compatible thunk entry function */
 typedef void (*CThunkEntry)(void);
 
+#if defined(CTHUNK_HOST)
+/* Bind a free entry of the host table to a thunk, for CThunk only
+ *
+ * @param dispatch function called by the entry with thunk
+ * @param thunk the thunk
+ * @returns the entry function
+ */
+CThunkEntry cthunk_host_bind(void (*dispatch)(void *thunk), void *thunk);
+
+/* Give an entry of the host table back, for CThunk only */
+void cthunk_host_unbind(CThunkEntry entry);
+#endif
+
 template<class T>
 class CThunk
 {
@@ -84,7 +110,9 @@ class CThunk
         }
 
         ~CThunk() {
-
+#if defined(CTHUNK_HOST)
+            cthunk_host_unbind(m_entry);
+#endif
         }
 
         inline CThunk(T *instance, CCallbackSimple callback)
@@ -117,6 +145,28 @@ class CThunk
             m_callback = (CCallback)callback;
         }
 
+#if defined(CTHUNK_HOST)
+        inline void context(void* context)
+        {
+            m_context = context;
+        }
+
+        inline void context(uint32_t context)
+        {
+            m_context = (void*)(uintptr_t)context;
+        }
+
+        inline uint32_t entry(void)
+        {
+            return (uint32_t)(uintptr_t)m_entry;
+        }
+
+        /* get thunk entry point for connecting rhunk to an IRQ table */
+        inline operator CThunkEntry(void)
+        {
+            return m_entry;
+        }
+#else
         inline void context(void* context)
         {
             m_thunk.context = (uint32_t)context;
@@ -137,6 +187,7 @@ class CThunk
         {
             return (CThunkEntry)entry();
         }
+#endif
 
         /* get thunk entry point for connecting rhunk to an IRQ table */
         inline operator uint32_t(void)
@@ -147,13 +198,43 @@ class CThunk
         /* simple test function */
         inline void call(void)
         {
-            (((CThunkEntry)(entry()))());
+            ((CThunkEntry)(*this))();
         }
 
     private:
         T* m_instance;
         volatile CCallback m_callback;
 
+        static void trampoline(T* instance, void* context, CCallback* callback)
+        {
+            if(instance && *callback) {
+                (static_cast<T*>(instance)->**callback)(context);
+            }
+        }
+
+#if defined(CTHUNK_HOST)
+        // the entry is bound to this object, which can't be copied
+        CThunk(const CThunk &);
+        CThunk &operator=(const CThunk &);
+
+        static void dispatch(void *thunk)
+        {
+            CThunk *self = static_cast<CThunk*>(thunk);
+            trampoline(self->m_instance, self->m_context, (CCallback*)&self->m_callback);
+        }
+
+        void* volatile m_context;
+        CThunkEntry m_entry;
+
+        inline void init(T *instance, CCallback callback, void* context)
+        {
+            m_callback = callback;
+            m_instance = instance;
+            m_context = context;
+            m_entry = cthunk_host_bind(&CThunk::dispatch, this);
+        }
+#else
+
 // TODO: this needs proper fix, to refactor toolchain header file and all its use
 // PACKED there is not defined properly for IAR
 #if defined (__ICCARM__)
@@ -176,13 +257,6 @@ class CThunk
         } __attribute__((__packed__)) CThunkTrampoline;
 #endif
 
-        static void trampoline(T* instance, void* context, CCallback* callback)
-        {
-            if(instance && *callback) {
-                (static_cast<T*>(instance)->**callback)(context);
-            }
-        }
-
         volatile CThunkTrampoline m_thunk;
 
         inline void init(T *instance, CCallback callback, void* context)
@@ -201,6 +275,7 @@ class CThunk
             __ISB();
             __DSB();
         }
+#endif
 };
 
 #endif/*__CTHUNK_H__*/
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_COMPLETIONQUEUE_H
+#define MBED_COMPLETIONQUEUE_H
+
+#include <stdint.h>
+#include "SPSCRing.h"
+
+/* Number of completions each driver can have waiting for the completion
+ * task, a power of two */
+#ifndef YOTTA_CFG_MBED_DRIVERS_COMPLETION_QUEUE_SIZE
+#   define YOTTA_CFG_MBED_DRIVERS_COMPLETION_QUEUE_SIZE 2
+#endif
+
+namespace mbed {
+
+/** A source of completions, run by the completion task
+ *
+ * The sources are kept in a list, which a single minar task walks to run
+ * the completions of the sources signalled since its last run. Signalling
+ * only sets a flag, and posts the task if it isn't posted yet: the
+ * completions themselves never allocate, and the interrupts post one minar
+ * callback per batch of completions instead of one per completion.
+ *
+ * This batches the posts, it doesn't remove them: posting the task still
+ * allocates a callback from minar, as any minar::Scheduler::postCallback()
+ * does, so an isolated completion costs one allocation, as much as before.
+ * wakeups() counts the posts.
+ *
+ * Sources are created and destroyed from thread mode or minar tasks, and
+ * may be static.
+ */
+class CompletionSource {
+public:
+    CompletionSource();
+    virtual ~CompletionSource();
+
+    /** Get the number of times the completion task was posted
+     */
+    static uint32_t wakeups();
+
+protected:
+    /** Have run_completions() called by the completion task, from an
+     *  interrupt handler
+     */
+    void signal();
+
+    /** Run the completions waiting, from the completion task
+     */
+    virtual void run_completions() = 0;
+
+    /** Run the completions of the signalled sources, the completion task
+     */
+    static void run();
+
+private:
+    CompletionSource(const CompletionSource &);
+    CompletionSource &operator=(const CompletionSource &);
+
+    static void post();
+
+    CompletionSource *_next;
+    volatile bool _signalled;
+};
+
+/** A queue of completions, pushed to by one interrupt handler and run by
+ *  the completion task
+ *
+ * The completions are copied into a preallocated SPSCRing: queueing one
+ * from an interrupt handler takes a bounded time and doesn't allocate, only
+ * the first completion of a batch posts the completion task (see
+ * CompletionSource). The drivers fall back to posting a minar callback when
+ * the queue is full, which allocates.
+ *
+ * @tparam Completion the type of the completions, which is copied, and
+ *                    whose complete() method runs them
+ * @tparam Size the number of completions which can wait, a power of two
+ */
+template<typename Completion, uint32_t Size = YOTTA_CFG_MBED_DRIVERS_COMPLETION_QUEUE_SIZE>
+class CompletionQueue : public CompletionSource {
+public:
+    CompletionQueue() : _overflows(0) {
+    }
+
+    /** Queue a completion, from the interrupt handler of the queue
+     *
+     * @param completion the completion to run from the completion task
+     * @return True if the completion was queued, false if the queue is full
+     */
+    bool post(const Completion &completion) {
+        if (!_ring.push(completion)) {
+            _overflows++;
+            return false;
+        }
+        signal();
+        return true;
+    }
+
+    /** Get the number of completions which didn't fit in the queue
+     */
+    uint32_t overflows() const {
+        return _overflows;
+    }
+
+protected:
+    virtual void run_completions() {
+        Completion completion;
+
+        // the completions posted while these run signal the queue again
+        for (uint32_t i = 0; i < Size && _ring.pop(completion); i++) {
+            completion.complete();
+        }
+    }
+
+private:
+    SPSCRing<Completion, Size> _ring;
+    volatile uint32_t _overflows;
+};
+
+} // namespace mbed
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_CYCLETIMER_H
+#define MBED_CYCLETIMER_H
+
+#include <stdint.h>
+
+#if defined(TARGET_LIKE_CORTEX_M3) || defined(TARGET_LIKE_CORTEX_M4) || defined(TARGET_LIKE_CORTEX_M7)
+#   define MBED_CYCLETIMER_DWT 1
+#   include "cmsis.h"
+#   include "us_ticker_api.h"
+#elif defined(TARGET_LIKE_POSIX)
+#   define MBED_CYCLETIMER_POSIX 1
+#   include <time.h>
+#else
+#   include "us_ticker_api.h"
+#endif
+
+namespace mbed {
+
+/** A high resolution timer, counting CPU cycles
+ *
+ * The counter is the DWT cycle counter on Cortex-M3/M4/M7, which runs at the
+ * core clock (SystemCoreClock when the counter was set up). Cores without a
+ * cycle counter fall back to the us ticker, and host builds to
+ * clock_gettime(), counting nanoseconds.
+ *
+ * Unlike Timer, reading the counter is an inline register read, and the
+ * conversion helpers are a multiply and a shift, so they can be used in
+ * interrupt handlers and hot paths. The counter is 32 bits: a CycleTimer
+ * must be read at least once per wrap (about 44 seconds at 96MHz), use a
+ * Timer for longer times.
+ *
+ * Example:
+ * @code
+ * #include "mbed.h"
+ *
+ * CycleTimer timer;
+ *
+ * void app_start(int, char*[]) {
+ *     timer.start();
+ *     // ...
+ *     printf("took %lu ns\r\n", (unsigned long)timer.read_ns());
+ * }
+ * @endcode
+ */
+class CycleTimer {
+public:
+    CycleTimer();
+
+    /** Start the timer
+     */
+    void start();
+
+    /** Stop the timer
+     */
+    void stop();
+
+    /** Reset the timer to 0.
+     *
+     * If it was already counting, it will continue
+     */
+    void reset();
+
+    /** Get the time passed in counter ticks
+     */
+    uint64_t read_counts();
+
+    /** Get the time passed in nano-seconds
+     */
+    uint64_t read_ns();
+
+    /** Get the time passed in seconds
+     */
+    float read();
+
+    /** Set the counter up, if it isn't already
+     *
+     * Creating a CycleTimer or calling wait_ns() does it too.
+     */
+    static void init();
+
+    /** Read the counter
+     *
+     * The counter must have been set up, see init().
+     */
+    static inline uint32_t now() {
+#if MBED_CYCLETIMER_DWT
+        if (_use_dwt) {
+            return DWT->CYCCNT;
+        }
+        return us_ticker_read();
+#elif MBED_CYCLETIMER_POSIX
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32_t)ts.tv_sec * 1000000000u + (uint32_t)ts.tv_nsec;
+#else
+        return us_ticker_read();
+#endif
+    }
+
+    /** Get the frequency of the counter in Hz
+     */
+    static uint32_t frequency() {
+        return _frequency;
+    }
+
+    /** Convert counter ticks to nano-seconds, rounding down
+     *
+     * The result must fit on 32 bits (about 4.29 seconds).
+     */
+    static inline uint32_t counts_to_ns(uint32_t counts) {
+        return ((uint64_t)counts * _ns_mult) >> _ns_shift;
+    }
+
+    /** Convert nano-seconds to counter ticks, rounding up
+     */
+    static inline uint32_t ns_to_counts(uint32_t ns) {
+        return ((uint64_t)ns * _counts_mult + ((uint64_t)1 << _counts_shift) - 1) >> _counts_shift;
+    }
+
+protected:
+    uint32_t slicecounts();
+    int _running;       // whether the timer is running
+    uint32_t _start;    // the start count of the latest slice
+    uint64_t _counts;   // any accumulated counts from previous slices
+
+private:
+    static void scale(uint64_t num, uint64_t den, uint32_t &mult, uint8_t &shift);
+
+    static bool _initialised;
+    static bool _use_dwt;
+    static uint32_t _frequency;
+    static uint32_t _ns_mult;       // ns = counts * _ns_mult >> _ns_shift
+    static uint32_t _counts_mult;   // counts = ns * _counts_mult >> _counts_shift
+    static uint8_t _ns_shift;
+    static uint8_t _counts_shift;
+};
+
+} // namespace mbed
+
+#endif
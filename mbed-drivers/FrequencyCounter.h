@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_FREQUENCYCOUNTER_H
+#define MBED_FREQUENCYCOUNTER_H
+
+#include "platform.h"
+
+#if DEVICE_INTERRUPTIN
+
+#include "InterruptIn.h"
+#include "Ticker.h"
+
+/* Maximum number of gate windows a FrequencyCounter can average over */
+#ifndef YOTTA_CFG_MBED_DRIVERS_FREQUENCY_COUNTER_MAX_AVERAGING
+#   define YOTTA_CFG_MBED_DRIVERS_FREQUENCY_COUNTER_MAX_AVERAGING 8
+#endif
+
+namespace mbed {
+
+/** Measure the frequency of a signal on an InterruptIn
+ *
+ * The InterruptIn counts the rising edges of the signal in counting mode,
+ * without calling any function per edge, and a Ticker samples the count
+ * at the end of each gate window. The frequency is the number of edges
+ * over the last windows divided by their length, measured with the ticker
+ * of the InterruptIn, so a late Ticker doesn't skew it.
+ *
+ * Longer windows, or more of them, give finer and steadier readings, at
+ * the cost of following changes more slowly.
+ *
+ * Example:
+ * @code
+ * #include "mbed.h"
+ *
+ * InterruptIn tacho(p5);
+ * FrequencyCounter rpm(tacho, 250000, 4);
+ *
+ * void report(void) {
+ *     printf("%f rpm\r\n", rpm.read() * 60.0f);
+ * }
+ *
+ * void app_start(int, char*[]) {
+ *     rpm.start();
+ *     minar::Scheduler::postCallback(report).period(minar::milliseconds(1000));
+ * }
+ * @endcode
+ */
+class FrequencyCounter {
+public:
+    /** Create a FrequencyCounter on an input
+     *
+     *  @param input the input carrying the signal, in counting mode while
+     *               the FrequencyCounter runs
+     *  @param gate_us the length of a gate window in micro-seconds
+     *  @param averaging the number of windows to average over, up to
+     *                   YOTTA_CFG_MBED_DRIVERS_FREQUENCY_COUNTER_MAX_AVERAGING
+     */
+    FrequencyCounter(InterruptIn &input, timestamp_t gate_us = 100000, int averaging = 1);
+
+    virtual ~FrequencyCounter() {
+        stop();
+    }
+
+    /** Put the input in counting mode and start measuring
+     *
+     *  The readings are restarted from scratch.
+     */
+    void start();
+
+    /** Stop measuring, and take the input out of counting mode
+     */
+    void stop();
+
+    /** Get the frequency in Hz, averaged over the last windows
+     *
+     *  @returns
+     *  The frequency, 0 before the end of the first window
+     */
+    float read();
+
+    /** Get the number of edges and their time span used by read()
+     *
+     *  @param edges filled with the number of edges
+     *  @param span_us filled with the time they were counted over, in micro-seconds
+     */
+    void read_count(uint32_t *edges, uint32_t *span_us);
+
+#ifdef MBED_OPERATORS
+    /** An operator shorthand for read()
+     */
+    operator float() {
+        return read();
+    }
+#endif
+
+protected:
+    void sample();
+
+    InterruptIn &_input;
+    Ticker _gate;
+    timestamp_t _gate_us;
+    int _averaging;
+
+    // the last windows, in a ring written by the gate Ticker
+    uint32_t _edges[YOTTA_CFG_MBED_DRIVERS_FREQUENCY_COUNTER_MAX_AVERAGING];
+    uint32_t _spans[YOTTA_CFG_MBED_DRIVERS_FREQUENCY_COUNTER_MAX_AVERAGING];
+    int _next;
+    int _windows;
+    uint32_t _sum_edges;
+    uint32_t _sum_span;
+    uint32_t _last_count;
+    timestamp_t _last_time;
+};
+
+} // namespace mbed
+
+#endif
+
+#endif
@@ -28,6 +28,7 @@
 #include "dma_api.h"
 #include "core-util/FunctionPointer.h"
 #include "Transaction.h"
+#include "CompletionQueue.h"
 #endif
 
 namespace mbed {
@@ -180,6 +181,7 @@ protected:
 
     void irq_handler_asynch(void);
     transaction_data_t _current_transaction;
+    CompletionQueue<transaction_data_t> _completions;
     CThunk<I2C> _irq;
     DMAUsage _usage;
 #endif
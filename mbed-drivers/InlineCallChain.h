@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_INLINECALLCHAIN_H
+#define MBED_INLINECALLCHAIN_H
+
+#include <stdint.h>
+#include "CallChain.h"
+#include "cmsis.h"
+#include "core-util/critical.h"
+
+namespace mbed {
+
+/** Storage for the function objects of one or more InlineCallChains
+ *
+ * An arena is a fixed number of slots, each holding a function object, which
+ * the chains sharing the arena take as functions are added and give back as
+ * they are removed. Sharing an arena lets chains use as much memory as all
+ * their functions need together, instead of the maximum of each chain.
+ *
+ * An arena must outlive its chains.
+ *
+ * Example:
+ * @code
+ * StaticCallChainArena<8> arena;
+ * InlineCallChain rx_chain(arena);
+ * InlineCallChain tx_chain(arena);
+ * @endcode
+ */
+class CallChainArena {
+public:
+    /** Create an arena
+     *
+     *  @param capacity The number of slots, at most 254
+     */
+    CallChainArena(int capacity);
+    ~CallChainArena();
+
+    /** Get the number of slots
+     */
+    int capacity() const {
+        return _capacity;
+    }
+
+    /** Get the number of free slots
+     */
+    int available() const {
+        return _available;
+    }
+
+protected:
+    /** Create an arena using the given storage
+     *
+     *  @param slots    storage for capacity function objects
+     *  @param next     storage for capacity call order links
+     *  @param spare    storage for capacity free and retired list links
+     *  @param capacity the number of slots, at most 254
+     */
+    CallChainArena(mbed::util::FunctionPointer *slots, volatile uint8_t *next, uint8_t *spare, int capacity);
+
+private:
+    friend class InlineCallChain;
+
+    CallChainArena(const CallChainArena &);
+    CallChainArena &operator=(const CallChainArena &);
+
+    /** End of a list of slots */
+    static const uint8_t NONE = 0xFF;
+
+    void init_slots();
+    void lock();
+    void unlock();
+
+    mbed::util::FunctionPointer *_slots;
+    volatile uint8_t *_next;        // call order links
+    uint8_t *_spare;                // free and retired list links
+    uint8_t _free;                  // first free slot
+    uint8_t _capacity;
+    uint8_t _available;
+    uint8_t _writer;                // set while a writer changes a chain
+    bool _owned;
+};
+
+/** A CallChainArena of N slots, which doesn't use the heap
+ */
+template<int N>
+class StaticCallChainArena : public CallChainArena {
+public:
+    StaticCallChainArena() : CallChainArena(_storage, _storage_next, _storage_spare, N) {
+    }
+
+private:
+    // the slots are numbered with uint8_t, and 0xFF ends the lists
+    typedef char capacity_must_be_at_most_254[N <= 254 ? 1 : -1];
+
+    mbed::util::FunctionPointer _storage[N];
+    volatile uint8_t _storage_next[N];
+    uint8_t _storage_spare[N];
+};
+
+/** A CallChain which never allocates after its construction
+ *
+ * The function objects are stored by value in a single array, sized once by
+ * the constructor, instead of being allocated one by one: adding and
+ * removing functions never touches the heap, and call() walks contiguous
+ * memory. When the chain is full, add() and add_front() return NULL.
+ *
+ * The function objects don't move while they are in the chain, so the
+ * pointers returned by add() and add_front() stay valid until they are
+ * removed, as with CallChain.
+ *
+ * The chain may be changed from any context, including interrupt handlers,
+ * while call() runs: call() never blocks, and sees every function which was
+ * in the chain for the whole call. The call order is a list linked through
+ * the slots; functions are added by writing their slot then linking it in,
+ * and removed by unlinking their slot, so a call() in progress always
+ * follows valid links. The slot of a removed function is retired until no
+ * call() is running, and only then reused: the last call() to return gives
+ * the retired slots back to the arena. As a consequence, a function
+ * removed while call() runs may still be called once by that call(), and
+ * add() may return NULL while retired slots wait for the running calls to
+ * complete.
+ *
+ * See StaticCallChain for a chain which doesn't use the heap at all, and
+ * CallChainArena for chains sharing their storage.
+ *
+ * Example:
+ * @code
+ * #include "mbed.h"
+ *
+ * InlineCallChain chain(8);
+ *
+ * void first(void) {
+ *     printf("'first' function.\n");
+ * }
+ *
+ * void second(void) {
+ *     printf("'second' function.\n");
+ * }
+ *
+ * int main() {
+ *     chain.add(second);
+ *     chain.add_front(first);
+ *     chain.call();
+ * }
+ * @endcode
+ */
+class InlineCallChain {
+public:
+    /** Create an empty chain
+     *
+     *  @param capacity The maximum number of functions in the chain, at most 254
+     */
+    InlineCallChain(int capacity);
+
+    /** Create an empty chain taking its slots from an arena
+     *
+     *  The chain can hold as many functions as the arena has free slots.
+     *
+     *  @param arena The arena, shared with other chains
+     */
+    InlineCallChain(CallChainArena &arena);
+    virtual ~InlineCallChain();
+
+    /** Add a function at the end of the chain
+     *
+     *  @param function A pointer to a void function
+     *
+     *  @returns
+     *  The function object created for 'function', NULL if the chain is full
+     */
+    pFunctionPointer_t add(void (*function)(void)) {
+        return common_add(mbed::util::FunctionPointer(function), false);
+    }
+
+    /** Add a function at the end of the chain
+     *
+     *  @param tptr pointer to the object to call the member function on
+     *  @param mptr pointer to the member function to be called
+     *
+     *  @returns
+     *  The function object created for 'tptr' and 'mptr', NULL if the chain is full
+     */
+    template<typename T>
+    pFunctionPointer_t add(T *tptr, void (T::*mptr)(void)) {
+        return common_add(mbed::util::FunctionPointer(tptr, mptr), false);
+    }
+
+    /** Add a function at the beginning of the chain
+     *
+     *  @param function A pointer to a void function
+     *
+     *  @returns
+     *  The function object created for 'function', NULL if the chain is full
+     */
+    pFunctionPointer_t add_front(void (*function)(void)) {
+        return common_add(mbed::util::FunctionPointer(function), true);
+    }
+
+    /** Add a function at the beginning of the chain
+     *
+     *  @param tptr pointer to the object to call the member function on
+     *  @param mptr pointer to the member function to be called
+     *
+     *  @returns
+     *  The function object created for 'tptr' and 'mptr', NULL if the chain is full
+     */
+    template<typename T>
+    pFunctionPointer_t add_front(T *tptr, void (T::*mptr)(void)) {
+        return common_add(mbed::util::FunctionPointer(tptr, mptr), true);
+    }
+
+    /** Get the number of functions in the chain
+     */
+    int size() const {
+        return _elements;
+    }
+
+    /** Get the number of slots waiting for the running calls to complete
+     */
+    int retired() const {
+        return _retired_count;
+    }
+
+    /** Check if call() is running, in this or another context
+     */
+    bool calling() const {
+        return _readers != 0;
+    }
+
+    /** Get the maximum number of functions in the chain, which may be
+     *  shared with other chains, see CallChainArena
+     */
+    int capacity() const {
+        return _arena->capacity();
+    }
+
+    /** Get a function object from the chain
+     *
+     *  @param i function object index
+     *
+     *  @returns
+     *  The function object at position 'i' in the chain
+     */
+    pFunctionPointer_t get(int i) const;
+
+    /** Look for a function object in the call chain
+     *
+     *  @param f the function object to search
+     *
+     *  @returns
+     *  The index of the function object if found, -1 otherwise.
+     */
+    int find(pFunctionPointer_t f) const;
+
+    /** Clear the call chain (remove all functions in the chain).
+     */
+    void clear();
+
+    /** Remove a function object from the chain
+     *
+     *  @arg f the function object to remove
+     *
+     *  @returns
+     *  true if the function object was found and removed, false otherwise.
+     */
+    bool remove(pFunctionPointer_t f);
+
+    /** Call all the functions in the chain in sequence
+     *
+     *  Safe to call from several contexts at once, and while the chain is
+     *  changed.
+     */
+    void call() {
+        pin();
+        for (uint8_t slot = _head; slot != NONE; slot = _next[slot]) {
+            _slots[slot].call();
+        }
+        unpin();
+    }
+
+#ifdef MBED_OPERATORS
+    void operator ()(void) {
+        call();
+    }
+    pFunctionPointer_t operator [](int i) const {
+        return get(i);
+    }
+#endif
+
+private:
+    // adds the function objects it builds, and pins the chains it calls
+    friend class InterruptManager;
+
+    InlineCallChain(const InlineCallChain &);
+    InlineCallChain &operator=(const InlineCallChain &);
+
+    static const uint8_t NONE = CallChainArena::NONE;
+
+    /* Count the running calls. On a single core, the calls preempting
+     * another one are complete before it resumes, so a plain increment
+     * doesn't lose counts; threads of a host need atomics. */
+    void pin() {
+#if defined(TARGET_LIKE_POSIX)
+        core_util_atomic_incr_u32((uint32_t *)&_readers, 1);
+#else
+        _readers++;
+#endif
+    }
+
+    void unpin() {
+#if defined(TARGET_LIKE_POSIX)
+        uint32_t readers = core_util_atomic_decr_u32((uint32_t *)&_readers, 1);
+#else
+        uint32_t readers = --_readers;
+#endif
+        // the count must be visible before the retired slots are checked,
+        // see reclaim()
+        __DMB();
+        if (readers == 0 && _retired != NONE) {
+            reclaim_unpinned();
+        }
+    }
+
+    void init();
+    void reclaim();
+    void reclaim_unpinned();
+    void release(uint8_t first);
+    pFunctionPointer_t common_add(const mbed::util::FunctionPointer &function, bool front);
+
+    CallChainArena *_arena;
+    mbed::util::FunctionPointer *_slots;    // the arena's, for call()
+    volatile uint8_t *_next;
+    volatile uint8_t _head;         // first slot in call order
+    uint8_t _tail;                  // last slot in call order
+    uint8_t _retired;               // first retired slot
+    uint8_t _retired_count;
+    uint8_t _elements;
+    bool _owns_arena;
+    volatile uint32_t _readers;     // number of running calls
+};
+
+/** An InlineCallChain with room for N functions, which doesn't use the heap
+ *
+ * Example:
+ * @code
+ * StaticCallChain<4> chain;
+ * @endcode
+ */
+template<int N>
+class StaticCallChain : private StaticCallChainArena<N>, public InlineCallChain {
+public:
+    // the arena is a base class, so that it is built before the chain
+    StaticCallChain() : StaticCallChainArena<N>(), InlineCallChain(static_cast<CallChainArena &>(*this)) {
+    }
+
+    using InlineCallChain::capacity;
+};
+
+} // namespace mbed
+
+#endif
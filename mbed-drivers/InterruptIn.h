@@ -23,6 +23,8 @@
 
 #include "gpio_api.h"
 #include "gpio_irq_api.h"
+#include "ticker_api.h"
+#include "us_ticker_api.h"
 #include "core-util/FunctionPointer.h"
 
 namespace mbed {
@@ -54,13 +56,21 @@ namespace mbed {
 class InterruptIn {
 
 public:
+    /** An edge recorded in capture mode, see capture()
+     */
+    struct Edge {
+        timestamp_t timestamp;  /**< ticker time of the edge interrupt */
+        bool rise;              /**< true for a rising edge, false for a falling one */
+    };
+
+    typedef mbed::util::FunctionPointer2<void, const Edge *, uint32_t> capture_handler_t;
 
     /** Create an InterruptIn connected to the specified pin
      *
      *  @param pin InterruptIn pin to connect to
-     *  @param name (optional) A string to identify the object
+     *  @param data the ticker timing the edges, debouncing and rate limiting
      */
-    InterruptIn(PinName pin);
+    InterruptIn(PinName pin, const ticker_data_t *data = get_us_ticker_data());
     virtual ~InterruptIn();
 
      int read();
@@ -83,7 +93,7 @@ public:
     template<typename T>
     void rise(T* tptr, void (T::*mptr)(void)) {
         _rise.attach(tptr, mptr);
-        gpio_irq_set(&gpio_irq, IRQ_RISE, 1);
+        update_irq();
     }
 
     /** Attach a function to call when a falling edge occurs on the input
@@ -100,7 +110,87 @@ public:
     template<typename T>
     void fall(T* tptr, void (T::*mptr)(void)) {
         _fall.attach(tptr, mptr);
-        gpio_irq_set(&gpio_irq, IRQ_FALL, 1);
+        update_irq();
+    }
+
+    /** Record the edges, and deliver them in batches from a minar task
+     *
+     *  In capture mode, the interrupt only stores each edge with the ticker
+     *  time into buffer, instead of calling the rise() and fall()
+     *  functions: it doesn't lock or allocate anything, and keeps up with
+     *  edges much faster than a function call per edge would. The
+     *  completion task (see CompletionSource), posted once per batch of
+     *  edges, then calls handler with the oldest edges waiting, which are
+     *  contiguous in buffer, and gives their room back once handler
+     *  returns; the edges waiting at the end and at the beginning of buffer
+     *  are delivered in two calls. Edges arriving while buffer is full are
+     *  dropped and counted by capture_overflows().
+     *
+     *  Capture is started and stopped from a minar task, which may be
+     *  handler itself.
+     *
+     *  @param buffer storage for the edges waiting to be delivered
+     *  @param size the number of edges in buffer, a power of two
+     *  @param handler called with each batch of edges and their number
+     *
+     *  @returns
+     *  true if capture started, false if size isn't a power of two
+     */
+    bool capture(Edge *buffer, uint32_t size, void (*handler)(const Edge *, uint32_t)) {
+        return start_capture(buffer, size, capture_handler_t(handler));
+    }
+
+    /** Record the edges, and deliver them in batches to a member function
+     *  from a minar task, see capture()
+     *
+     *  @param buffer storage for the edges waiting to be delivered
+     *  @param size the number of edges in buffer, a power of two
+     *  @param tptr pointer to the object to call the member function on
+     *  @param mptr pointer to the member function to be called
+     *
+     *  @returns
+     *  true if capture started, false if size isn't a power of two
+     */
+    template<typename T>
+    bool capture(Edge *buffer, uint32_t size, T *tptr, void (T::*mptr)(const Edge *, uint32_t)) {
+        return start_capture(buffer, size, capture_handler_t(tptr, mptr));
+    }
+
+    /** Stop capture, dropping the edges which weren't delivered, and call the
+     *  rise() and fall() functions again
+     */
+    void capture_stop();
+
+    /** Get the number of edges dropped because the capture buffer was full
+     */
+    uint32_t capture_overflows() const {
+        return _capture_overflows;
+    }
+
+    /** Count the edges instead of calling the rise() and fall() functions
+     *
+     *  In counting mode, the interrupt only increments a counter, read with
+     *  edge_count(), without calling any function. Counting stops capture
+     *  mode, and the other way round.
+     *
+     *  @param rise true to count the rising edges
+     *  @param fall true to count the falling edges
+     */
+    void count(bool rise = true, bool fall = false);
+
+    /** Stop counting, and call the rise() and fall() functions again
+     *
+     *  The counter keeps its value.
+     */
+    void count_stop();
+
+    /** Get the number of edges counted
+     *
+     *  The counter runs freely and wraps: the number of edges between two
+     *  reads is their difference.
+     */
+    uint32_t edge_count() const {
+        return _edge_count;
     }
 
     /** Set the input pin mode
@@ -109,6 +199,40 @@ public:
      */
     void mode(PinMode pull);
 
+    /** Debounce the input
+     *
+     *  After an edge, the interrupt is masked with disable_irq() until the
+     *  input settles, so that bounces don't cause interrupts. The level is
+     *  then read, and reported as an edge, to the rise() or fall() function
+     *  or to counting or capture mode (with the time of the first edge), if
+     *  it changed since the last settled level. While debouncing, both edge
+     *  interrupts are enabled, to follow the level.
+     *
+     *  The level is read from the Timeout ending the settle time, and
+     *  disable_irq() may mask a whole port on some targets. In capture
+     *  mode, that Timeout records the edge with interrupts disabled.
+     *
+     *  @param settle_us how long the input takes to settle in micro-seconds,
+     *                   0 to stop debouncing
+     */
+    void debounce(timestamp_t settle_us);
+
+    /** Mask the interrupt of the input during storms of edges
+     *
+     *  When more than max_edges edges happen within a millisecond, the
+     *  interrupt is masked with disable_irq() for holdoff_us, dropping the
+     *  edges, and the storm is counted by storms().
+     *
+     *  @param max_edges the number of edges per millisecond allowed, 0 for
+     *                   no limit
+     *  @param holdoff_us how long the interrupt is masked in micro-seconds
+     */
+    void rate_limit(uint32_t max_edges, timestamp_t holdoff_us = 1000);
+
+    /** Get the number of times the interrupt was masked by rate_limit()
+     */
+    uint32_t storms() const;
+
     /** Enable IRQ. This method depends on hw implementation, might enable one
      *  port interrupts. For further information, check gpio_irq_enable().
      */
@@ -122,11 +246,48 @@ public:
     static void _irq_handler(uint32_t id, gpio_irq_event event);
 
 protected:
+    friend class FrequencyCounter;
+    struct Filter;
+    struct Delivery;
+
+    bool start_capture(Edge *buffer, uint32_t size, const capture_handler_t &handler);
+    void update_irq();
+    void dispatch(gpio_irq_event event, timestamp_t timestamp);
+    void filter_edge(gpio_irq_event event);
+    void holdoff_expired();
+    Filter *get_filter();
+    void put_filter();
+    void record_edge(timestamp_t timestamp, bool rise);
+    void deliver_edges();
+
     gpio_t gpio;
     gpio_irq_t gpio_irq;
+    const ticker_data_t *const _ticker_data;
 
     mbed::util::FunctionPointer _rise;
     mbed::util::FunctionPointer _fall;
+
+    // capture mode, a ring of free-running counters like SPSCRing's, pushed
+    // to by the interrupt and popped from by the delivery task
+    Edge * volatile _capture;
+    uint32_t _capture_size;
+    volatile uint32_t _capture_head;
+    volatile uint32_t _capture_tail;
+    volatile uint32_t _capture_overflows;
+    capture_handler_t _capture_handler;
+
+    // counting mode
+    volatile bool _counting;
+    bool _count_rise;
+    bool _count_fall;
+    volatile uint32_t _edge_count;
+
+    // debouncing and rate limiting, allocated when first used
+    Filter * volatile _filter;
+
+    // the completion source delivering the edges, allocated by the first
+    // capture
+    Delivery *_delivery;
 };
 
 } // namespace mbed
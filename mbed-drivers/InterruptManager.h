@@ -18,12 +18,47 @@
 #define MBED_INTERRUPTMANAGER_H
 
 #include "cmsis.h"
-#include "CallChain.h"
+#include "InlineCallChain.h"
 #include <string.h>
 
+/* Maximum number of interrupts with chained handlers at the same time */
+#ifndef YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS
+#   define YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS 8
+#endif
+
+/* Number of handlers shared by all the chained interrupts, including the
+ * vector which was installed before the first handler of each interrupt was
+ * added, at most 254 */
+#ifndef YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS
+#   define YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS 16
+#endif
+#if YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS > 254
+#   error "YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS must be at most 254"
+#endif
+
 namespace mbed {
 
 /** Use this singleton if you need to chain interrupt handlers.
+ *
+ * Only the interrupts with chained handlers use memory: their exception
+ * numbers are kept in a small sorted index, searched by the vector of a
+ * chained interrupt with the active exception number read from IPSR, and
+ * their handlers share one arena of slots (see CallChainArena). Up to
+ * YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS interrupts can have chained
+ * handlers, which are YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS in total,
+ * counting the vector each interrupt had before its first handler was added.
+ * The RAM used is the index, the arena (in the instance, see get()), and one
+ * InlineCallChain on the heap per chained interrupt.
+ *
+ * Handlers may be added and removed from interrupt handlers, including the
+ * handlers of the same interrupt, see InlineCallChain. A chain is built with
+ * the previous vector and the first handler before it is published, and is
+ * looked up and changed with interrupts disabled, so an interrupt changing
+ * the handlers at the same time never sees it half done. Adding the first
+ * handler of an interrupt allocates its chain. When a single handler is
+ * left, the interrupt vector calls it directly and the chain is deleted; if
+ * the chain is being called at that time, this waits for the next handler
+ * to be added or removed.
  *
  * Example (for LPC1768):
  * @code
@@ -65,7 +100,8 @@ public:
      *  @param irq interrupt number
      *
      *  @returns
-     *  The function object created for 'function'
+     *  The function object created for 'function', NULL if there is no room
+     *  left for the handler
      */
     pFunctionPointer_t add_handler(void (*function)(void), IRQn_Type irq) {
         return add_common(function, irq);
@@ -77,7 +113,8 @@ public:
      *  @param irq interrupt number
      *
      *  @returns
-     *  The function object created for 'function'
+     *  The function object created for 'function', NULL if there is no room
+     *  left for the handler
      */
     pFunctionPointer_t add_handler_front(void (*function)(void), IRQn_Type irq) {
         return add_common(function, irq, true);
@@ -90,7 +127,8 @@ public:
      *  @param irq interrupt number
      *
      *  @returns
-     *  The function object created for 'tptr' and 'mptr'
+     *  The function object created for 'tptr' and 'mptr', NULL if there is no
+     *  room left for the handler
      */
     template<typename T>
     pFunctionPointer_t add_handler(T* tptr, void (T::*mptr)(void), IRQn_Type irq) {
@@ -104,7 +142,8 @@ public:
      *  @param irq interrupt number
      *
      *  @returns
-     *  The function object created for 'tptr' and 'mptr'
+     *  The function object created for 'tptr' and 'mptr', NULL if there is no
+     *  room left for the handler
      */
     template<typename T>
     pFunctionPointer_t add_handler_front(T* tptr, void (T::*mptr)(void), IRQn_Type irq) {
@@ -121,6 +160,26 @@ public:
      */
     bool remove_handler(pFunctionPointer_t handler, IRQn_Type irq);
 
+    /** Call the handlers chained on an interrupt, as its vector does
+     *
+     *  @param irq the interrupt number
+     */
+    static void call_handlers(IRQn_Type irq) {
+        call_chain((int)irq + NVIC_USER_IRQ_OFFSET);
+    }
+
+    /** Get the number of interrupts with chained handlers
+     */
+    static int shared_vectors() {
+        return _count;
+    }
+
+    /** Get the number of free handler slots
+     */
+    int available_handlers() const {
+        return _arena.available();
+    }
+
 private:
     InterruptManager();
     ~InterruptManager();
@@ -133,24 +192,35 @@ private:
 
     template<typename T>
     pFunctionPointer_t add_common(T *tptr, void (T::*mptr)(void), IRQn_Type irq, bool front=false) {
-        int irq_pos = get_irq_index(irq);
-        bool change = must_replace_vector(irq);
+        return add_common(mbed::util::FunctionPointer(tptr, mptr), irq, front);
+    }
 
-        pFunctionPointer_t pf = front ? _chains[irq_pos]->add_front(tptr, mptr) : _chains[irq_pos]->add(tptr, mptr);
-        if (change)
-            NVIC_SetVector(irq, (uint32_t)&InterruptManager::static_irq_helper);
-        return pf;
+    pFunctionPointer_t add_common(void (*function)(void), IRQn_Type irq, bool front=false) {
+        return add_common(mbed::util::FunctionPointer(function), irq, front);
     }
 
-    pFunctionPointer_t add_common(void (*function)(void), IRQn_Type irq, bool front=false);
-    bool must_replace_vector(IRQn_Type irq);
+    pFunctionPointer_t add_common(const mbed::util::FunctionPointer &function, IRQn_Type irq, bool front);
+    void collapse_chains();
+    static void insert_chain(int irq_pos, InlineCallChain *chain);
+    static void unlink_chain(int i);
     int get_irq_index(IRQn_Type irq);
-    void irq_helper();
-    void add_helper(void (*function)(void), IRQn_Type irq, bool front=false);
+    static int find_index(int irq_pos);
+    static void call_chain(int irq_pos);
     static void static_irq_helper();
 
-    CallChain* _chains[NVIC_NUM_VECTORS];
+    static InlineCallChain *find_chain(int irq_pos) {
+        int i = find_index(irq_pos);
+        return i < 0 ? NULL : _chains[i];
+    }
+
+    // sorted exception numbers of the chained interrupts, and their chains
+    static uint16_t _vectors[YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS];
+    static InlineCallChain* _chains[YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS];
+    static volatile int _count;
     static InterruptManager* _instance;
+
+    // built with the instance, so that it exists before any handler is added
+    StaticCallChainArena<YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS> _arena;
 };
 
 } // namespace mbed
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_PROFILEZONE_H
+#define MBED_PROFILEZONE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CycleTimer.h"
+
+/* Set to 1 to build the MBED_PROFILE_ZONE() zones in, they compile to
+ * nothing otherwise */
+#ifndef YOTTA_CFG_MBED_DRIVERS_PROFILING
+#   define YOTTA_CFG_MBED_DRIVERS_PROFILING 0
+#endif
+
+namespace mbed {
+
+/** Statistics of a profiling zone
+ *
+ * A ProfileSite must have static storage, and be initialised with
+ * MBED_PROFILE_SITE_INIT() so that no constructor runs, even when it is a
+ * static local variable used from an interrupt handler. It is added to the
+ * ProfileRegistry the first time a ProfileZone uses it.
+ *
+ * Times are in CycleTimer counts.
+ */
+struct ProfileSite {
+    const char *name;       /**< Name of the zone, as reported by ProfileRegistry */
+    uint32_t count;         /**< Number of times the zone was run */
+    uint32_t min;           /**< Shortest run */
+    uint32_t max;           /**< Longest run */
+    uint64_t total;         /**< Total run time */
+    ProfileSite *next;      /**< Next site in the registry */
+    bool registered;        /**< Whether the site is in the registry */
+};
+
+/** Static initialiser of a ProfileSite */
+#define MBED_PROFILE_SITE_INIT(zone_name) { (zone_name), 0, 0xFFFFFFFFu, 0, 0, NULL, false }
+
+/** Registry of all the profiling zones which have run
+ *
+ * All the functions may be called from interrupt handlers.
+ */
+class ProfileRegistry {
+public:
+    /** Add a site to the registry, if it isn't already
+     */
+    static void add(ProfileSite &site);
+
+    /** Record a run of a zone
+     *
+     * @param site   The zone's statistics
+     * @param counts The run time, in CycleTimer counts
+     */
+    static void record(ProfileSite &site, uint32_t counts);
+
+    /** Get the first site of the registry, the others are linked by
+     *  ProfileSite::next
+     */
+    static ProfileSite *first() {
+        return _first;
+    }
+
+    /** Clear the statistics of all the zones
+     */
+    static void reset();
+
+    /** Send the statistics of all the zones to the greentea host
+     *
+     * Each zone is sent as four performance coefficients,
+     * "<name>_count", "<name>_min_ns", "<name>_max_ns" and "<name>_mean_ns".
+     */
+    static void report();
+
+    /** Print the statistics of all the zones on stdout, one zone per line
+     */
+    static void print();
+
+private:
+    static ProfileSite *_first;
+};
+
+/** Measure the run time of a scope
+ *
+ * The time from the construction to the destruction of a ProfileZone is
+ * recorded in a ProfileSite. The CycleTimer counter is read once on each
+ * side, so a zone costs a few tens of cycles. Zones longer than a wrap of
+ * the CycleTimer counter are not measured correctly.
+ *
+ * Zones are normally declared with MBED_PROFILE_ZONE(), which compiles to
+ * nothing unless YOTTA_CFG_MBED_DRIVERS_PROFILING is set.
+ *
+ * Example:
+ * @code
+ * #include "mbed.h"
+ *
+ * void on_rx() {
+ *     MBED_PROFILE_ZONE("on_rx");
+ *     // ...
+ * }
+ *
+ * void app_start(int, char*[]) {
+ *     // ...
+ *     ProfileRegistry::print();
+ * }
+ * @endcode
+ */
+class ProfileZone {
+public:
+    ProfileZone(ProfileSite &site) : _site(site) {
+        if (!site.registered) {
+            ProfileRegistry::add(site);
+        }
+        _start = CycleTimer::now();
+    }
+
+    ~ProfileZone() {
+        ProfileRegistry::record(_site, CycleTimer::now() - _start);
+    }
+
+private:
+    ProfileZone(const ProfileZone &);
+    ProfileZone &operator=(const ProfileZone &);
+
+    ProfileSite &_site;
+    uint32_t _start;
+};
+
+} // namespace mbed
+
+#define MBED_PROFILE_CONCAT_(a, b) a ## b
+#define MBED_PROFILE_CONCAT(a, b) MBED_PROFILE_CONCAT_(a, b)
+
+/** Profile the rest of the enclosing scope as the zone zone_name
+ *
+ * zone_name must be a string literal. Several zones may be declared in the
+ * same scope, on different lines.
+ */
+#if YOTTA_CFG_MBED_DRIVERS_PROFILING
+#define MBED_PROFILE_ZONE(zone_name) \
+    static mbed::ProfileSite MBED_PROFILE_CONCAT(_profile_site_, __LINE__) = MBED_PROFILE_SITE_INIT(zone_name); \
+    mbed::ProfileZone MBED_PROFILE_CONCAT(_profile_zone_, __LINE__)(MBED_PROFILE_CONCAT(_profile_site_, __LINE__))
+#else
+#define MBED_PROFILE_ZONE(zone_name)
+#endif
+
+#endif
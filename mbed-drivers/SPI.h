@@ -29,6 +29,7 @@
 #include "CircularBuffer.h"
 #include "core-util/FunctionPointer.h"
 #include "Transaction.h"
+#include "CompletionQueue.h"
 
 #ifndef YOTTA_CFG_MBED_DRIVERS_SPI_TRANSACTION_QUEUE
 #   define YOTTA_CFG_MBED_DRIVERS_SPI_TRANSACTION_QUEUE 16
@@ -178,7 +179,7 @@ public:
      */
     void abort_transfer();
 
-    /** Clear the transaction buffer
+    /** Clear the transaction buffer of the SPI peripheral
      */
     void clear_transfer_buffer();
 
@@ -193,6 +194,41 @@ public:
     */
     int set_dma_usage(DMAUsage usage);
 
+    /** Get the number of transfers waiting for the SPI peripheral
+     *
+     *  Each physical SPI peripheral has its own queue of transfers, shared
+     *  by the SPI objects using it, allocated when the first of them is
+     *  created. It holds TRANSACTION_QUEUE_SIZE_SPI transfers, unless
+     *  resized with set_transfer_queue_size().
+     */
+    uint32_t transfer_queue_depth() const;
+
+    /** Set the number of transfers which can wait for the SPI peripheral
+     *
+     *  This resizes the queue shared by all the SPI objects of the physical
+     *  SPI peripheral.
+     *
+     *  @param size The number of transfers, 0 for no queue
+     *  @return Zero if the queue was resized, -1 if transfers are waiting in
+     *          it
+     */
+    int set_transfer_queue_size(uint32_t size);
+
+    /** Get the largest number of transfers which waited for the SPI
+     *  peripheral at once
+     */
+    uint32_t transfer_queue_high_water() const;
+
+    /** Get the number of transfers refused because the queue of the SPI
+     *  peripheral was full
+     */
+    uint32_t transfer_queue_overflows() const;
+
+    /** Reset the high water mark and overflow counter of the queue of the
+     *  SPI peripheral
+     */
+    void reset_transfer_queue_stats();
+
 protected:
     /** SPI IRQ handler
      *
@@ -230,28 +266,47 @@ protected:
 #endif
 
 public:
-    virtual ~SPI() {
-    }
+    virtual ~SPI();
 
 protected:
-    spi_t _spi;
+    /** The state shared by the SPI objects of a physical SPI peripheral,
+     *  allocated when the first of them is created
+     */
+    struct Bus {
+        Bus(uint32_t peripheral);
 
+        uint32_t peripheral;    /**< The peripheral, from the pinmaps */
+        Bus *next;              /**< The next bus in SPI::_buses */
+        SPI *owner;             /**< The SPI object the format and frequency were set for */
 #if DEVICE_SPI_ASYNCH
-#if TRANSACTION_QUEUE_SIZE_SPI
-    static CircularBuffer<transaction_t, TRANSACTION_QUEUE_SIZE_SPI> _transaction_buffer;
+        transaction_t *transactions; /**< Ring of the transfers waiting */
+        uint32_t size;          /**< Number of transfers the ring holds */
+        uint32_t head;          /**< Index of the next transfer */
+        uint32_t depth;         /**< Number of transfers in the queue */
+        uint32_t high_water;    /**< Largest depth */
+        uint32_t overflows;     /**< Number of transfers refused */
+        bool busy;              /**< Whether a transfer is on-going */
 #endif
+    };
+
+    static Bus *get_bus(PinName mosi, PinName miso, PinName sclk);
+
+    static Bus *_buses;
+    Bus *_bus;
+    spi_t _spi;
+
+#if DEVICE_SPI_ASYNCH
     CThunk<SPI> _irq;
     transaction_data_t _current_transaction;
+    CompletionQueue<transaction_data_t> _completions;
     DMAUsage _usage;
 #endif
 
     void aquire(void);
-    static SPI *_owner;
     int _bits;
     int _mode;
     spi_bitorder_t _order;
     int _hz;
-    bool _busy;
 };
 
 } // namespace mbed
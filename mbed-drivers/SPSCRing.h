@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_SPSCRING_H
+#define MBED_SPSCRING_H
+
+#include <stdint.h>
+#include "cmsis.h"
+
+namespace mbed {
+
+/** Templated lock-free single producer, single consumer ring buffer
+ *
+ * One context, e.g. an interrupt handler, pushes to the ring while another,
+ * e.g. a minar task, pops from it, without either of them disabling
+ * interrupts. Several producers, or several consumers, must not preempt
+ * each other.
+ *
+ * Unlike CircularBuffer, a full ring refuses new data instead of
+ * overwriting the oldest.
+ *
+ * @tparam T the type of the elements, which is copied in and out
+ * @tparam BufferSize the number of elements, a power of two
+ */
+template<typename T, uint32_t BufferSize>
+class SPSCRing {
+public:
+    SPSCRing() : _head(0), _tail(0) {
+    }
+
+    /** Push data to the ring, from the producer
+     *
+     * @param data Data to be pushed to the ring
+     * @return True if data was pushed, false if the ring is full
+     */
+    bool push(const T& data) {
+        uint32_t head = _head;
+        if (head - _tail == BufferSize) {
+            return false;
+        }
+        _pool[head % BufferSize] = data;
+        // the data must be in place before the consumer can see it
+        __DMB();
+        _head = head + 1;
+        return true;
+    }
+
+    /** Pop data from the ring, from the consumer
+     *
+     * @param data Filled with the oldest data of the ring
+     * @return True if the ring was not empty and data was filled, false otherwise
+     */
+    bool pop(T& data) {
+        uint32_t tail = _tail;
+        if (tail == _head) {
+            return false;
+        }
+        __DMB();
+        data = _pool[tail % BufferSize];
+        // the slot must be read before the producer can reuse it
+        __DMB();
+        _tail = tail + 1;
+        return true;
+    }
+
+    /** Replace the data waiting in the ring which is equal to old, from the
+     *  consumer
+     *
+     * @param old Data to be replaced
+     * @param replacement Data replacing it
+     */
+    void replace(const T& old, const T& replacement) {
+        for (uint32_t i = _tail; i != _head; i++) {
+            if (_pool[i % BufferSize] == old) {
+                _pool[i % BufferSize] = replacement;
+            }
+        }
+    }
+
+    /** Check if the ring is empty
+     *
+     * @return True if the ring is empty, false if not
+     */
+    bool empty() const {
+        return _head == _tail;
+    }
+
+    /** Check if the ring is full
+     *
+     * @return True if the ring is full, false if not
+     */
+    bool full() const {
+        return _head - _tail == BufferSize;
+    }
+
+private:
+    // the counters run freely and wrap, which is only consistent with the
+    // modulo for sizes which are powers of two
+    typedef char size_must_be_a_power_of_two[(BufferSize & (BufferSize - 1)) == 0 ? 1 : -1];
+
+    T _pool[BufferSize];
+    volatile uint32_t _head;    // written by the producer only
+    volatile uint32_t _tail;    // written by the consumer only
+};
+
+} // namespace mbed
+
+#endif
@@ -29,6 +29,7 @@
 #if DEVICE_SERIAL_ASYNCH
 #include "CThunk.h"
 #include "dma_api.h"
+#include "CompletionQueue.h"
 #endif
 
 namespace mbed {
@@ -216,6 +217,7 @@ protected:
     CThunk<SerialBase> _thunk_irq;
     transaction_data_t _current_tx_transaction;
     transaction_data_t _current_rx_transaction;
+    CompletionQueue<transaction_data_t> _completions;
     DMAUsage _tx_usage;
     DMAUsage _rx_usage;
 #endif
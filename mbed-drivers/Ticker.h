@@ -20,6 +20,12 @@
 #include "TimerEvent.h"
 #include "core-util/FunctionPointer.h"
 
+/* Number of deferred calls which can wait for the minar task running them,
+ * a power of two */
+#ifndef YOTTA_CFG_MBED_DRIVERS_TICKER_DEFERRED_QUEUE_SIZE
+#   define YOTTA_CFG_MBED_DRIVERS_TICKER_DEFERRED_QUEUE_SIZE 32
+#endif
+
 namespace mbed {
 
 /** A Ticker is used to call a function at a recurring interval
@@ -58,19 +64,93 @@ namespace mbed {
 class Ticker : public TimerEvent {
 
 public:
-    Ticker() : TimerEvent() {
+    /** What to do when a call is so late that the next one is already due
+     */
+    enum OverrunPolicy {
+        CatchUp = 0,    /**< Make the missed calls back to back (default) */
+        Skip,           /**< Drop the missed calls, stay on the original schedule */
+        Realign         /**< Drop the missed calls, count the next interval from now */
+    };
+
+    Ticker() : TimerEvent(), _policy(CatchUp), _overruns(0), _missed(0), _deferred(false) {
+    }
+
+    Ticker(const ticker_data_t *const data) : TimerEvent(data), _policy(CatchUp), _overruns(0), _missed(0), _deferred(false) {
+    }
+
+    /** Create a Ticker with a coarse resolution, see TimerWheel
+     *
+     *  @param wheel the timer wheel to use for intervals of a wheel tick or more
+     */
+    Ticker(TimerWheel &wheel) : TimerEvent(wheel), _policy(CatchUp), _overruns(0), _missed(0), _deferred(false) {
+    }
+
+    /** Set what to do when the Ticker falls behind, see OverrunPolicy
+     *
+     *  @param policy the overrun policy
+     */
+    void set_overrun_policy(OverrunPolicy policy) {
+        _policy = policy;
     }
 
-    Ticker(const ticker_data_t *const data) : TimerEvent(data) {
+    /** Get the number of times a call was so late that the next one was
+     *  already due
+     */
+    uint32_t overruns() const {
+        return _overruns;
+    }
+
+    /** Get the number of calls dropped by the Skip and Realign policies
+     */
+    uint32_t missed_ticks() const {
+        return _missed;
     }
 
+    /** Reset the overrun and missed call counters
+     */
+    void reset_overrun_counters() {
+        _overruns = 0;
+        _missed = 0;
+    }
+
+    /** Call the function from a minar task instead of the timer interrupt
+     *
+     *  The timer interrupt only queues the call, so a slow function doesn't
+     *  delay the other timer events and interrupts. The calls of all the
+     *  deferred Tickers share a queue of
+     *  YOTTA_CFG_MBED_DRIVERS_TICKER_DEFERRED_QUEUE_SIZE calls, a
+     *  CompletionSource run in batches by the completion task, which yields
+     *  to the other minar tasks between batches. Calls which don't fit are
+     *  dropped, and counted by deferred_overflows(). Tickers of different
+     *  tickers, e.g. the us and low power tickers, queue from interrupts
+     *  which may preempt each other, so the calls are queued with the
+     *  interrupts disabled.
+     *
+     *  A deferred Ticker must be detached, destroyed or made not deferred
+     *  from a minar task.
+     *
+     *  @param deferred true to call the function from a minar task
+     */
+    void set_deferred(bool deferred);
+
+    /** Check if the function is called from a minar task
+     */
+    bool deferred() const {
+        return _deferred;
+    }
+
+    /** Get the number of deferred calls dropped because the queue was full
+     */
+    static uint32_t deferred_overflows();
+
     /** Attach a function to be called by the Ticker, specifiying the interval in seconds
      *
      *  @param fptr pointer to the function to be called
      *  @param t the time between calls in seconds
+     *  @param slack how late each call may be in seconds, see attach_us()
      */
-    void attach(void (*fptr)(void), float t) {
-        attach_us(fptr, t * 1000000.0f);
+    void attach(void (*fptr)(void), float t, float slack = 0) {
+        attach_us(fptr, t * 1000000.0f, slack * 1000000.0f);
     }
 
     /** Attach a member function to be called by the Ticker, specifiying the interval in seconds
@@ -78,20 +158,27 @@ public:
      *  @param tptr pointer to the object to call the member function on
      *  @param mptr pointer to the member function to be called
      *  @param t the time between calls in seconds
+     *  @param slack how late each call may be in seconds, see attach_us()
      */
     template<typename T>
-    void attach(T* tptr, void (T::*mptr)(void), float t) {
-        attach_us(tptr, mptr, t * 1000000.0f);
+    void attach(T* tptr, void (T::*mptr)(void), float t, float slack = 0) {
+        attach_us(tptr, mptr, t * 1000000.0f, slack * 1000000.0f);
     }
 
     /** Attach a function to be called by the Ticker, specifiying the interval in micro-seconds
+     *
+     *  A non-zero slack lets each call happen up to slack micro-seconds late,
+     *  so that it can share an interrupt with other timer events due in that
+     *  window. The calls don't drift: each interval is still counted from the
+     *  nominal time of the previous call.
      *
      *  @param fptr pointer to the function to be called
      *  @param t the time between calls in micro-seconds
+     *  @param slack how late each call may be in micro-seconds
      */
-    void attach_us(void (*fptr)(void), timestamp_t t) {
+    void attach_us(void (*fptr)(void), timestamp_t t, timestamp_t slack = 0) {
         _function.attach(fptr);
-        setup(t);
+        setup(t, slack);
     }
 
     /** Attach a member function to be called by the Ticker, specifiying the interval in micro-seconds
@@ -99,11 +186,12 @@ public:
      *  @param tptr pointer to the object to call the member function on
      *  @param mptr pointer to the member function to be called
      *  @param t the time between calls in micro-seconds
+     *  @param slack how late each call may be in micro-seconds
      */
     template<typename T>
-    void attach_us(T* tptr, void (T::*mptr)(void), timestamp_t t) {
+    void attach_us(T* tptr, void (T::*mptr)(void), timestamp_t t, timestamp_t slack = 0) {
         _function.attach(tptr, mptr);
-        setup(t);
+        setup(t, slack);
     }
 
     virtual ~Ticker() {
@@ -115,11 +203,26 @@ public:
     void detach();
 
 protected:
-    void setup(timestamp_t t);
+    void setup(timestamp_t t, timestamp_t slack = 0);
     virtual void handler();
 
+    // call the function now, or queue the call if the Ticker is deferred
+    void call_function();
+
+private:
+    class DeferredCalls;
+    static DeferredCalls _deferred_calls;
+
+    void forget_deferred_calls();
+
 protected:
     timestamp_t                _delay;     /**< Time delay (in microseconds) for re-setting the multi-shot callback. */
+    timestamp_t                _slack;     /**< How late (in microseconds) the callback may be called. */
+    timestamp_t                _deadline;  /**< Nominal time of the next call, before slack is applied. */
+    OverrunPolicy              _policy;    /**< What to do when the next call is already due. */
+    uint32_t                   _overruns;  /**< Number of times the next call was already due. */
+    uint32_t                   _missed;    /**< Number of calls dropped by the overrun policy. */
+    bool                       _deferred;  /**< Whether the callback is called from a minar task. */
     mbed::util::FunctionPointer _function;  /**< Callback. */
 };
 
@@ -51,7 +51,47 @@ namespace mbed {
  */
 class Timeout : public Ticker {
 
+public:
+    Timeout() : Ticker() {
+    }
+
+    Timeout(const ticker_data_t *const data) : Ticker(data) {
+    }
+
+    /** Create a Timeout with a coarse resolution, see TimerWheel
+     *
+     *  @param wheel the timer wheel to use for delays of a wheel tick or more
+     */
+    Timeout(TimerWheel &wheel) : Ticker(wheel) {
+    }
+
+    /** Attach a function to be called by the Timeout, specifiying the delay in micro-seconds
+     *
+     *  Unlike attach_us(), the delay can be longer than the 32-bit ticker
+     *  can represent, e.g. several hours.
+     *
+     *  @param fptr pointer to the function to be called
+     *  @param t the delay in micro-seconds
+     */
+    void attach_us64(void (*fptr)(void), us_timestamp_t t) {
+        _function.attach(fptr);
+        setup_us64(t);
+    }
+
+    /** Attach a member function to be called by the Timeout, specifiying the delay in micro-seconds
+     *
+     *  @param tptr pointer to the object to call the member function on
+     *  @param mptr pointer to the member function to be called
+     *  @param t the delay in micro-seconds
+     */
+    template<typename T>
+    void attach_us64(T* tptr, void (T::*mptr)(void), us_timestamp_t t) {
+        _function.attach(tptr, mptr);
+        setup_us64(t);
+    }
+
 protected:
+    void setup_us64(us_timestamp_t t);
     virtual void handler();
 };
 
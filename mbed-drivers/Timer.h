@@ -19,6 +19,7 @@
 
 #include "platform.h"
 #include "ticker_api.h"
+#include "ticker_api_ext.h"
 
 namespace mbed {
 
@@ -75,15 +76,21 @@ public:
      */
     int read_us();
 
+    /** Get the time passed in micro-seconds, without wrapping
+     *
+     *  read_us() goes negative after about 35 minutes, this doesn't.
+     */
+    us_timestamp_t read_high_resolution_us();
+
 #ifdef MBED_OPERATORS
     operator float();
 #endif
 
 protected:
-    int slicetime();
+    us_timestamp_t slicetime();
     int _running;          // whether the timer is running
-    unsigned int _start;   // the start time of the latest slice
-    int _time;             // any accumulated time from previous slices
+    us_timestamp_t _start; // the start time of the latest slice
+    us_timestamp_t _time;  // any accumulated time from previous slices
     const ticker_data_t *const _ticker_data;
 };
 
@@ -18,16 +18,50 @@
 #define MBED_TIMEREVENT_H
 
 #include "ticker_api.h"
+#include "ticker_api_ext.h"
+
+/* On targets with a low power ticker, TimerEvents on the us ticker wait for
+ * deadlines further than this many microseconds on the low power ticker */
+#ifndef YOTTA_CFG_MBED_DRIVERS_LP_TICKER_THRESHOLD_US
+#   define YOTTA_CFG_MBED_DRIVERS_LP_TICKER_THRESHOLD_US 100000
+#endif
+
+/* How long before the deadline such TimerEvents move back to the us ticker.
+ * Another 1/1024th of the time to wait is added for the drift between both
+ * tickers. */
+#ifndef YOTTA_CFG_MBED_DRIVERS_LP_TICKER_HANDOVER_US
+#   define YOTTA_CFG_MBED_DRIVERS_LP_TICKER_HANDOVER_US 2000
+#endif
 
 namespace mbed {
 
+class TimerWheel;
+
 /** Base abstraction for timer interrupts
+ *
+ * On targets with a low power ticker (DEVICE_LOWPOWERTIMER), TimerEvents on
+ * the us ticker wait for far deadlines on the low power ticker, so that the
+ * us ticker can be stopped in deep sleep, and move back to the us ticker
+ * shortly before the deadline. The low power ticker is only initialised
+ * when the first far deadline is inserted. Other tickers can be paired with
+ * a low power ticker with ticker_set_low_power().
 */
 class TimerEvent {
+    friend class TimerWheel;
 public:
     TimerEvent();
     TimerEvent(const ticker_data_t *data);
 
+    /** Create a TimerEvent which puts coarse deadlines on a timer wheel
+     *
+     *  Deadlines at least one wheel tick away are kept on the wheel, which
+     *  makes arming and cancelling them O(1) at the cost of firing up to one
+     *  wheel tick late. See TimerWheel.
+     *
+     *  @param wheel the timer wheel to use
+     */
+    TimerEvent(TimerWheel &wheel);
+
     /** The handler registered with the underlying timer interrupt
      */
     static void irq(uint32_t id);
@@ -40,8 +74,13 @@ protected:
     // The handler called to service the timer event of the derived class
     virtual void handler() = 0;
 
-    // insert in to linked list
-    void insert(timestamp_t timestamp);
+    // insert in to linked list, firing up to slack microseconds late if that
+    // lets it share an interrupt with another event
+    void insert(timestamp_t timestamp, timestamp_t slack = 0);
+
+    // insert with a 64-bit deadline, see ticker_read_us64(). Deadlines too
+    // far away for the 32-bit ticker are reached through intermediate events.
+    void insert_absolute_us64(us_timestamp_t timestamp);
 
     // remove from linked list, if in it
     void remove();
@@ -49,6 +88,29 @@ protected:
     ticker_event_t event;
 
     const ticker_data_t *const _ticker_data;
+    TimerWheel *const _wheel;
+
+private:
+    // call handler(), unless this was an intermediate event
+    void dispatch();
+
+    // the low power ticker paired with _ticker_data, or NULL
+    const ticker_data_t *lp_ticker_data() const;
+
+    // wait on the low power ticker if the deadline is far enough
+    bool insert_lp(timestamp_t timestamp);
+
+    // move from the low power ticker back to the us ticker
+    void handover();
+
+    us_timestamp_t _timestamp64;    // deadline given to insert_absolute_us64()
+    bool _far;                      // the queued event is an intermediate one
+    const ticker_data_t *_lp_data;  // the low power ticker the event is queued on, or NULL
+    timestamp_t _lp_deadline;       // low power ticker time of the deadline
+
+    // links in a timer wheel slot
+    TimerEvent *_wheel_next;
+    TimerEvent **_wheel_pprev;
 };
 
 } // namespace mbed
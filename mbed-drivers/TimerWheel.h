@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_TIMERWHEEL_H
+#define MBED_TIMERWHEEL_H
+
+#include "TimerEvent.h"
+
+/* Length of a wheel tick, as a power of two microseconds (10: 1.024ms) */
+#ifndef YOTTA_CFG_MBED_DRIVERS_TIMER_WHEEL_RESOLUTION_SHIFT
+#   define YOTTA_CFG_MBED_DRIVERS_TIMER_WHEEL_RESOLUTION_SHIFT 10
+#endif
+
+namespace mbed {
+
+/** A hierarchical timing wheel for coarse resolution TimerEvents
+ *
+ * TimerEvents created with a TimerWheel put every deadline that is at least
+ * one wheel tick away on the wheel instead of the ticker's event queue.
+ * Arming and cancelling them is O(1), and the wheel itself uses a single
+ * ticker event, armed for the next wheel tick with work to do, so thousands
+ * of coarse timers cost one hardware compare.
+ *
+ * Deadlines are rounded up to the next wheel tick, so a TimerEvent on the
+ * wheel fires up to one tick late, and never early. Deadlines closer than
+ * one tick still go through the ticker's event queue.
+ *
+ * The wheel has three levels of 64 slots, covering 2^18 ticks (about 268
+ * seconds with the default resolution). Later deadlines are parked in the
+ * last level and moved down as they get closer.
+ *
+ * Example:
+ * @code
+ * #include "mbed.h"
+ *
+ * TimerWheel wheel;
+ * Timeout retry(wheel);
+ *
+ * void resend() {
+ *     // ...
+ * }
+ *
+ * void app_start(int, char*[]) {
+ *     retry.attach(&resend, 2.0);
+ * }
+ * @endcode
+ *
+ * The TimerWheel must outlive the TimerEvents created with it.
+ */
+class TimerWheel : public TimerEvent {
+public:
+    TimerWheel();
+    TimerWheel(const ticker_data_t *data);
+
+    /** Get the number of TimerEvents on the wheel
+     */
+    uint32_t size() const {
+        return _count;
+    }
+
+    /** Get the length of a wheel tick in microseconds
+     */
+    static timestamp_t resolution() {
+        return (timestamp_t)1 << SHIFT;
+    }
+
+protected:
+    friend class TimerEvent;
+
+    /** Put a TimerEvent on the wheel
+     *
+     *  @param te the TimerEvent, which must not be queued already
+     *  @param timestamp its deadline
+     *  @returns true if the TimerEvent is on the wheel, false if the deadline
+     *    is less than a tick away and must be queued on the ticker instead
+     */
+    bool add(TimerEvent *te, timestamp_t timestamp);
+
+    /** Take a TimerEvent off the wheel, if it's on it
+     */
+    void cancel(TimerEvent *te);
+
+    virtual void handler();
+
+private:
+    static const unsigned SHIFT = YOTTA_CFG_MBED_DRIVERS_TIMER_WHEEL_RESOLUTION_SHIFT;
+    static const unsigned LEVELS = 3;
+    static const unsigned SLOT_BITS = 6;
+    static const unsigned SLOTS = 1 << SLOT_BITS;
+    static const unsigned SLOT_MASK = SLOTS - 1;
+
+    void link(TimerEvent *te);
+    void unlink(TimerEvent *te);
+    void take(unsigned level, unsigned slot, TimerEvent *&list);
+    void run(uint32_t target);
+    void advance(uint32_t tick);
+    void cascade(unsigned level);
+    void expire();
+    bool next_pending(uint32_t &tick) const;
+    void schedule();
+    static int next_slot(const uint32_t *bits, unsigned start);
+
+    TimerEvent *_slots[LEVELS][SLOTS];
+    uint32_t _pending[LEVELS][SLOTS / 32];  // bitmap of non-empty slots
+    uint32_t _now;                          // next tick to process
+    timestamp_t _now_us;                    // ticker time of the start of _now
+    uint32_t _count;
+    uint32_t _armed_tick;
+    bool _armed;
+    bool _running;
+};
+
+} // namespace mbed
+
+#endif
@@ -30,6 +30,12 @@ struct OneWayTransaction {
     Buffer buffer;             /**< Transaction buffer */
     uint32_t event;            /**< Event for a transaction */
     Callback callback;         /**< User's callback */
+
+    /** Call the user's callback with the buffer and event, see CompletionQueue
+     */
+    void complete() {
+        callback.call(buffer, event);
+    }
 };
 
 /** Transactions in two directions (RX and TX)
@@ -40,6 +46,12 @@ struct TwoWayTransaction {
     Buffer rx_buffer;          /**< Receive buffer */
     uint32_t event;            /**< Event for a transaction */
     Callback callback;         /**< User's callback */
+
+    /** Call the user's callback with the buffers and event, see CompletionQueue
+     */
+    void complete() {
+        callback.call(tx_buffer, rx_buffer, event);
+    }
 };
 
 /** Transaction class defines a transaction.
@@ -55,7 +55,11 @@
 #include "Timer.h"
 #include "Ticker.h"
 #include "Timeout.h"
+#include "TimerWheel.h"
+#include "CycleTimer.h"
+#include "ProfileZone.h"
 #include "InterruptIn.h"
+#include "FrequencyCounter.h"
 #include "wait_api.h"
 #include "sleep_api.h"
 #include "rtc_time.h"
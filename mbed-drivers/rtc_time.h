@@ -15,6 +15,13 @@
  * limitations under the License.
  */
 #include <time.h>
+#include <stdint.h>
+#include "ticker_api.h"
+
+/* Seconds between two reads of the RTC, at most 4294 */
+#ifndef YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S
+#   define YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S 60
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +33,14 @@ extern "C" {
  * on the microcontroller Real-Time Clock (RTC), plus some
  * standard C manipulation and formating functions.
  *
+ * The time is read from the RTC once a minute (see
+ * YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S), and from a ticker in between: the
+ * low power ticker if the target has one, the us ticker otherwise. When
+ * the RTC and the ticker drift apart, the time is corrected by less than a
+ * second at the next read of the RTC. The time never goes back, apart from
+ * set_time(): when the RTC is behind the ticker, the time stays the same
+ * until the RTC catches up.
+ *
  * Example:
  * @code
  * #include "mbed.h"
@@ -69,6 +84,48 @@ extern "C" {
  */
 void set_time(time_t t);
 
+/** Get the current time, with microseconds
+ *
+ * Like gettimeofday(), this gives the fraction of the current second as
+ * well, which time() doesn't.
+ *
+ * @param seconds      If not NULL, set to the number of seconds since January 1, 1970
+ * @param microseconds If not NULL, set to the number of microseconds since the start of the second
+ * @returns the number of seconds since January 1, 1970
+ */
+time_t get_time_us(time_t *seconds, uint32_t *microseconds);
+
+/** Use another RTC
+ *
+ * Replaces the RTC of the target, if any. With a NULL read function, the
+ * time counts from the last set_time() on the time base ticker only, as on
+ * targets without an RTC.
+ *
+ * @param read      Reads the RTC, in seconds since January 1, 1970, or NULL
+ * @param write     Sets the RTC, or NULL
+ * @param init      Initialises the RTC, or NULL
+ * @param isenabled Returns whether the RTC is running, or NULL
+ */
+void attach_rtc(time_t (*read)(void), void (*write)(time_t), void (*init)(void), int (*isenabled)(void));
+
+/** Count the time between reads of the RTC on another ticker
+ *
+ * The time goes on from its current value on the new ticker.
+ *
+ * @param data The ticker's data, NULL for the default: the low power ticker
+ *             if the target has one, the us ticker otherwise
+ */
+void set_time_ticker(const ticker_data_t *data);
+
+/** Get the processor time, which doesn't wrap
+ *
+ * clock() wraps when it overflows a clock_t, this returns the same time
+ * on 64 bits.
+ *
+ * @returns the processor time, in CLOCKS_PER_SEC units
+ */
+uint64_t clock64(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_TICKER_API_EXT_H
+#define MBED_TICKER_API_EXT_H
+
+#include <stdint.h>
+#include "ticker_api.h"
+
+/* Number of lanes in the skip index kept next to each ticker queue. Set to 0
+ * to build ticker_api.c with the plain sorted list only. */
+#ifndef YOTTA_CFG_MBED_DRIVERS_TICKER_QUEUE_LANES
+#   define YOTTA_CFG_MBED_DRIVERS_TICKER_QUEUE_LANES 16
+#endif
+
+/* Set to 1 to record log2 histograms of the event latency and handler run
+ * time of each ticker, see ticker_get_histograms() */
+#ifndef YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+#   define YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS 0
+#endif
+
+/** Number of buckets of the ticker histograms */
+#define TICKER_HISTOGRAM_BUCKETS        16
+
+/** Don't use the lane index for this queue, walk the sorted list instead */
+#define TICKER_QUEUE_FLAG_NO_INDEX      (1 << 0)
+/** Set by ticker_api.c once the keepalive event for the 64-bit time is queued */
+#define TICKER_QUEUE_FLAG_KEEPALIVE     (1 << 1)
+/** Set by ticker_irq_handler() while it runs a batch of expired events */
+#define TICKER_QUEUE_FLAG_DISPATCHING   (1 << 2)
+
+/** Interval of the keepalive event, which makes sure ticker_read_us64() sees
+ * every wrap of the 32-bit ticker */
+#define TICKER_KEEPALIVE_INTERVAL       ((timestamp_t)1 << 30)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Microseconds since the ticker started, which doesn't wrap */
+typedef uint64_t us_timestamp_t;
+
+/** Ticker statistics
+ */
+typedef struct {
+    uint32_t coalesced;             /**< Events merged with another event's interrupt thanks to their slack */
+    uint32_t irqs;                  /**< Calls to ticker_irq_handler() */
+    uint32_t irq_events;            /**< Events run by ticker_irq_handler() */
+    uint32_t irq_ticks;             /**< Total time spent in ticker_irq_handler(), in ticker ticks */
+    uint32_t irq_ticks_max;         /**< Longest ticker_irq_handler() call, in ticker ticks */
+} ticker_stats_t;
+
+/** Histogram of durations, in ticker ticks
+ *
+ * Bucket 0 counts zero durations, bucket i durations from 2^(i-1) to
+ * 2^i - 1, and the last bucket all durations from 2^(TICKER_HISTOGRAM_BUCKETS - 2).
+ */
+typedef struct {
+    uint32_t buckets[TICKER_HISTOGRAM_BUCKETS];
+} ticker_histogram_t;
+
+/** Ticker event queue, as implemented by this module
+ *
+ * The event queue is a list of ticker_event_t sorted by timestamp. Since
+ * ticker_event_t only carries a single link, finding a position in the list
+ * is sped up by a small index of "lanes": pointers to events spread along the
+ * list, searched with a binary search before walking the list from the
+ * closest lane. Inserting and removing an event walks about events / lanes
+ * entries instead of all of them: with a fixed number of lanes this is still
+ * O(events), only with a shorter walk.
+ *
+ * The ticker_api.c implementation in this module expects the queue pointer of
+ * every ticker_data_t it is given to point at the `queue` member of a
+ * ticker_queue_t. This can't be checked: a ticker_data_t pointing at a bare
+ * ticker_event_queue_t makes ticker_api.c write past the end of it.
+ *
+ * @code
+ * static ticker_queue_t events;
+ *
+ * static const ticker_data_t data = {
+ *     .interface = &interface,
+ *     .queue = &events.queue,
+ * };
+ * @endcode
+ *
+ * A zero initialised ticker_queue_t is an empty queue.
+ */
+typedef struct {
+    ticker_event_queue_t queue;     /**< HAL event queue, must be the first member */
+    uint32_t length;                /**< Number of events in the queue */
+    uint32_t spacing;               /**< Walk length after which a new lane is added */
+    uint8_t flags;                  /**< TICKER_QUEUE_FLAG_* */
+    ticker_stats_t stats;           /**< Statistics, see ticker_get_stats() */
+    uint32_t wraps;                 /**< Upper 32 bits of the 64-bit time */
+    timestamp_t last_read;          /**< Lower 32 bits of the 64-bit time when it was last updated */
+    ticker_event_t keepalive;       /**< Updates the 64-bit time before the ticker wraps twice */
+    ticker_event_t wakeup;          /**< Wakes the CPU up without calling the event handler, see ticker_insert_wakeup() */
+    const ticker_data_t *low_power; /**< Ticker far TimerEvent deadlines wait on, see ticker_set_low_power() */
+    ticker_event_t *expired;        /**< Events of the batch being run by ticker_irq_handler() */
+    ticker_event_t *pending;        /**< Events inserted while a batch runs, sorted */
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+    ticker_histogram_t latency;     /**< How late events are run */
+    ticker_histogram_t handler_time; /**< How long event handlers run, see ticker_record_handler_time() */
+#endif
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_QUEUE_LANES
+    uint8_t lane_count;             /**< Number of lanes in use */
+    ticker_event_t *lanes[YOTTA_CFG_MBED_DRIVERS_TICKER_QUEUE_LANES]; /**< Lane index, in queue order */
+#endif
+} ticker_queue_t;
+
+/** Insert an event in the queue, allowing it to fire late to share an interrupt
+ *
+ * The event fires between timestamp and timestamp + slack. If another event
+ * is already due in that window, the new event is queued with the same
+ * timestamp so that both are handled by a single interrupt. Otherwise the
+ * timestamp is rounded up within the window to a "round" value, which makes
+ * events with overlapping windows more likely to line up in the future.
+ *
+ * @param data      The ticker's data
+ * @param obj       The event object to be inserted to the queue
+ * @param timestamp The earliest time the event may fire
+ * @param slack     How late, in ticks, the event may fire
+ * @param id        The event ID
+ */
+void ticker_insert_event_slack(const ticker_data_t *const data, ticker_event_t *obj, timestamp_t timestamp,
+                               timestamp_t slack, uint32_t id);
+
+/** Wake the CPU up at a given time, without calling the event handler
+ *
+ * The wakeup event belongs to the queue, so each ticker has a single wakeup
+ * time: it must be removed with ticker_remove_wakeup() before being inserted
+ * again. Used by wait_us() to sleep, from thread mode only.
+ *
+ * @param data      The ticker's data
+ * @param timestamp When to wake the CPU up
+ */
+void ticker_insert_wakeup(const ticker_data_t *const data, timestamp_t timestamp);
+
+/** Remove the wakeup event inserted by ticker_insert_wakeup()
+ *
+ * @param data The ticker's data
+ */
+void ticker_remove_wakeup(const ticker_data_t *const data);
+
+/** Pair a ticker with a low power ticker
+ *
+ * TimerEvents on the ticker wait for their deadlines further than
+ * YOTTA_CFG_MBED_DRIVERS_LP_TICKER_THRESHOLD_US on the low power ticker, and
+ * move back shortly before them. On targets with DEVICE_LOWPOWERTIMER, the
+ * us ticker is paired with the low power ticker unless this is called.
+ *
+ * @param data    The ticker's data
+ * @param lp_data The low power ticker's data, NULL to unpair
+ */
+void ticker_set_low_power(const ticker_data_t *const data, const ticker_data_t *lp_data);
+
+/** Get the low power ticker paired with ticker_set_low_power()
+ *
+ * @param data The ticker's data
+ * @return The low power ticker's data, NULL if none was paired
+ */
+const ticker_data_t *ticker_get_low_power(const ticker_data_t *const data);
+
+/** Read the 64-bit time of a ticker
+ *
+ * The 64-bit time is extended from the 32-bit ticker by counting its wraps.
+ * The first call, or the first ticker_set_handler() call, queues a keepalive
+ * event firing every TICKER_KEEPALIVE_INTERVAL ticks so that no wrap is
+ * missed, even if the 64-bit time isn't read for hours.
+ *
+ * Unlike ticker_read(), this never wraps. Wraps which happened before the
+ * keepalive event was queued are not counted.
+ *
+ * @param data The ticker's data
+ * @return The 64-bit ticker time
+ */
+us_timestamp_t ticker_read_us64(const ticker_data_t *const data);
+
+/** Get the statistics of a ticker
+ *
+ * @param data  The ticker's data
+ * @param stats Filled with the ticker's statistics
+ */
+void ticker_get_stats(const ticker_data_t *const data, ticker_stats_t *stats);
+
+/** Get the histograms of a ticker
+ *
+ * Both histograms are empty unless YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+ * is set.
+ *
+ * @param data         The ticker's data
+ * @param latency      Filled with the histogram of the time between the
+ *                     timestamp of the events and the call of their handler
+ * @param handler_time Filled with the histogram of the run time of the event
+ *                     handlers
+ */
+void ticker_get_histograms(const ticker_data_t *const data, ticker_histogram_t *latency,
+                           ticker_histogram_t *handler_time);
+
+/** Empty the histograms of a ticker
+ *
+ * @param data The ticker's data
+ */
+void ticker_reset_histograms(const ticker_data_t *const data);
+
+/** Record the run time of an event handler
+ *
+ * Called by TimerEvent, other users of the ticker may call it too.
+ *
+ * @param data  The ticker's data
+ * @param ticks The run time of the handler, in ticker ticks
+ */
+void ticker_record_handler_time(const ticker_data_t *const data, timestamp_t ticks);
+
+/** Send the histograms of a ticker to the greentea host
+ *
+ * Each bucket is sent as a performance coefficient, with keys such as
+ * "<name>_latency_16" for the latency bucket starting at 16 ticks.
+ * Does nothing unless YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS is set.
+ *
+ * @param data The ticker's data
+ * @param name The prefix of the keys
+ */
+void ticker_dump_histograms(const ticker_data_t *const data, const char *name);
+
+/** Get the number of events pending on a ticker
+ *
+ * @param data The ticker's data
+ * @return The number of events in the ticker's queue, not counting the
+ *         keepalive event, nor the events being run or inserted while
+ *         ticker_irq_handler() runs a batch of events
+ */
+uint32_t ticker_get_queue_length(const ticker_data_t *const data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,6 +22,7 @@
 
 #include "EphemeralBuffer.hpp"
 #include "core-util/FunctionPointer.h"
+#include "mbed-drivers/CompletionQueue.h"
 #include "PinNames.h"
 
 namespace mbed {
@@ -202,6 +203,9 @@ protected:
  *
  * handle_event() calls the registered event handlers for the current transaction, then frees the Transaction, using the
  * I2C object that originally issued the transaction.
+ *
+ * handle_event() is scheduled through a CompletionQueue, so that the interrupt handler doesn't allocate. When the queue
+ * is full, it is scheduled with a minar callback instead.
  */
 class I2CResourceManager {
 public:
@@ -293,8 +297,21 @@ protected:
      */
     ~I2CResourceManager();
 
+    // A handle_event() call, queued by process_event
+    struct Completion {
+        I2CResourceManager *manager;
+        I2CTransaction *transaction;
+        uint32_t event;
+
+        void complete() {
+            manager->handle_event(transaction, event);
+        }
+    };
+
     // The head of the transaction queue
     I2CTransaction * volatile _TransactionQueue;
+    // The handle_event() calls waiting for the completion task
+    CompletionQueue<Completion> _completions;
 };
 
 I2CResourceManager * get_i2c_owner(int I);
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_VIRTUAL_TICKER_H
+#define MBED_VIRTUAL_TICKER_H
+
+#include <stdint.h>
+#include "ticker_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Get the virtual ticker's data
+ *
+ * The virtual ticker is a ticker whose time only moves when
+ * virtual_ticker_advance() or virtual_ticker_run_next() is called. Its
+ * interrupt is simulated: instead of waiting for it, time jumps straight to
+ * the next deadline and ticker_irq_handler() is called. Timer, Ticker,
+ * Timeout and other TimerEvents built on it run as fast as the CPU allows,
+ * and always at exactly the same virtual times, which makes for quick and
+ * deterministic tests, on targets or on the host.
+ *
+ * There is a single virtual ticker, paired with a virtual low power ticker
+ * (see get_virtual_lp_ticker_data()). The functions below must not be
+ * called from their event handlers, apart from virtual_ticker_read(),
+ * virtual_lp_ticker_read() and virtual_ticker_delay().
+ *
+ * @code
+ * Timeout timeout(get_virtual_ticker_data());
+ * timeout.attach_us(callback, 1000000);
+ * virtual_ticker_advance(1000000); // calls callback
+ * @endcode
+ *
+ * @return The virtual ticker's data
+ */
+const ticker_data_t *get_virtual_ticker_data(void);
+
+/** Read the virtual ticker
+ *
+ * @return The virtual time, in ticks
+ */
+timestamp_t virtual_ticker_read(void);
+
+/** Get the virtual low power ticker's data
+ *
+ * The virtual low power ticker counts along with the virtual ticker, off by
+ * the drift set with virtual_lp_ticker_set_drift(). Its interrupts are run
+ * in time order with those of the virtual ticker by the functions below.
+ * Pair both with ticker_set_low_power() to have TimerEvents on the virtual
+ * ticker wait for far deadlines on the virtual low power ticker.
+ *
+ * @return The virtual low power ticker's data
+ */
+const ticker_data_t *get_virtual_lp_ticker_data(void);
+
+/** Read the virtual low power ticker
+ *
+ * @return The virtual low power time, in ticks
+ */
+timestamp_t virtual_lp_ticker_read(void);
+
+/** Set the drift of the virtual low power ticker
+ *
+ * @param ppm How much faster the virtual low power ticker counts than the
+ *            virtual ticker, in millionths, negative if it is slower
+ */
+void virtual_lp_ticker_set_drift(int32_t ppm);
+
+/** Move the virtual time forward
+ *
+ * All the interrupts due until the new time are run in order, with the
+ * virtual time set to their deadline.
+ *
+ * @param ticks The number of ticks to move forward, less than 2^31
+ * @return The number of interrupts run
+ */
+uint32_t virtual_ticker_advance(timestamp_t ticks);
+
+/** Move the virtual time forward without running the interrupts
+ *
+ * Like a slow event handler or a long critical section, this makes the
+ * interrupts due in the meantime late: they run on the next
+ * virtual_ticker_advance() or virtual_ticker_run_next(), without moving
+ * the virtual time back to their deadline.
+ *
+ * @param ticks The number of ticks to move forward, less than 2^31
+ */
+void virtual_ticker_delay(timestamp_t ticks);
+
+/** Move the virtual time to the next interrupt of either ticker and run it
+ *
+ * The virtual time is not changed if the interrupt is already due.
+ *
+ * @return 1 if an interrupt was run, 0 if none was set
+ */
+int virtual_ticker_run_next(void);
+
+/** Get the deadline of the next interrupt of the virtual ticker
+ *
+ * @param deadline Set to the deadline, if an interrupt is set
+ * @return 1 if an interrupt is set, 0 otherwise
+ */
+int virtual_ticker_get_deadline(timestamp_t *deadline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,13 +17,23 @@
 #ifndef MBED_WAIT_API_H
 #define MBED_WAIT_API_H
 
+#include <stdint.h>
+
+/* Default length, in microseconds, of the busy-wait which ends wait_us() */
+#ifndef YOTTA_CFG_MBED_DRIVERS_WAIT_SPIN_THRESHOLD_US
+#   define YOTTA_CFG_MBED_DRIVERS_WAIT_SPIN_THRESHOLD_US 50
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /** Generic wait functions.
  *
- * These provide simple NOP type wait capabilities.
+ * Waits longer than the spin threshold sleep until shortly before the end
+ * of the wait, woken up by the us ticker, then busy-wait for the rest of it.
+ * Shorter waits, and waits from interrupt handlers or with interrupts
+ * disabled, only busy-wait.
  *
  * Example:
  * @code
@@ -60,6 +70,39 @@ void wait_ms(int ms);
  */
 void wait_us(int us);
 
+/** Waits a number of nanoseconds.
+ *
+ *  Busy-waits on the counter of CycleTimer, so the resolution is a CPU
+ *  cycle where the cycle counter is available, a microsecond otherwise.
+ *
+ *  @param ns the number of nanoseconds to wait
+ */
+void wait_ns(unsigned int ns);
+
+/** Set how long the busy-wait at the end of a wait is
+ *
+ *  It has to cover the time the CPU takes to wake up, or waits end late.
+ *
+ *  @param us the spin threshold in microseconds
+ */
+void wait_set_spin_threshold_us(uint32_t us);
+
+/** Get how long the busy-wait at the end of a wait is
+ *
+ *  @returns the spin threshold in microseconds
+ */
+uint32_t wait_get_spin_threshold_us(void);
+
+/** Measure how late the CPU wakes up and set the spin threshold from it
+ *
+ *  Takes about 10 milliseconds. Must not be called from an interrupt
+ *  handler or with interrupts disabled, in which case the spin threshold
+ *  is left unchanged.
+ *
+ *  @returns the new spin threshold in microseconds
+ */
+uint32_t wait_calibrate(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/CThunk.h"
+
+#if defined(CTHUNK_HOST)
+
+#include "mbed-drivers/mbed_error.h"
+#include "core-util/critical.h"
+
+/* Number of CThunks which can exist at the same time on host builds */
+#ifndef YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES
+#   define YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES 32
+#endif
+
+namespace {
+
+struct HostSlot {
+    void (*dispatch)(void *thunk);
+    void *thunk;
+};
+
+HostSlot slots[YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES];
+
+template<int I>
+void host_entry(void) {
+    slots[I].dispatch(slots[I].thunk);
+}
+
+// Fill the table of entry functions, one instance of host_entry per slot
+template<int I>
+struct EntryTable {
+    static void fill(CThunkEntry *entries) {
+        EntryTable<I - 1>::fill(entries);
+        entries[I - 1] = &host_entry<I - 1>;
+    }
+};
+
+template<>
+struct EntryTable<0> {
+    static void fill(CThunkEntry *) {
+    }
+};
+
+CThunkEntry entries[YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES];
+
+} // namespace
+
+CThunkEntry cthunk_host_bind(void (*dispatch)(void *thunk), void *thunk) {
+    CThunkEntry entry = NULL;
+
+    core_util_critical_section_enter();
+    if (NULL == entries[0]) {
+        EntryTable<YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES>::fill(entries);
+    }
+    for (int i = 0; i < YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES; i++) {
+        if (NULL == slots[i].dispatch) {
+            slots[i].thunk = thunk;
+            slots[i].dispatch = dispatch;
+            entry = entries[i];
+            break;
+        }
+    }
+    core_util_critical_section_exit();
+    if (NULL == entry) {
+        error("CThunk: all %d host entries are in use", YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES);
+    } else if ((uintptr_t)(uint32_t)(uintptr_t)entry != (uintptr_t)entry) {
+        error("CThunk: entries are above 4GB, link without PIE");
+    }
+    return entry;
+}
+
+void cthunk_host_unbind(CThunkEntry entry) {
+    core_util_critical_section_enter();
+    for (int i = 0; i < YOTTA_CFG_MBED_DRIVERS_CTHUNK_HOST_ENTRIES; i++) {
+        if (entries[i] == entry) {
+            slots[i].dispatch = NULL;
+            slots[i].thunk = NULL;
+            break;
+        }
+    }
+    core_util_critical_section_exit();
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/CompletionQueue.h"
+#include "cmsis.h"
+#include "core-util/FunctionPointer.h"
+#include "core-util/CriticalSectionLock.h"
+#include "minar/minar.h"
+
+namespace mbed {
+
+using namespace mbed::util;
+
+namespace {
+// The sources, linked at construction
+CompletionSource *sources = NULL;
+// Counts the changes of the list, so that a walk knows when to restart
+volatile uint32_t generation = 0;
+// Written by the interrupts, read by the completion task
+volatile bool posted = false;
+volatile uint32_t posts = 0;
+}
+
+CompletionSource::CompletionSource() : _next(NULL), _signalled(false) {
+    CriticalSectionLock lock;
+    _next = sources;
+    sources = this;
+    generation++;
+}
+
+CompletionSource::~CompletionSource() {
+    CriticalSectionLock lock;
+    for (CompletionSource **link = &sources; *link != NULL; link = &(*link)->_next) {
+        if (*link == this) {
+            *link = _next;
+            break;
+        }
+    }
+    generation++;
+}
+
+uint32_t CompletionSource::wakeups() {
+    return posts;
+}
+
+void CompletionSource::signal() {
+    _signalled = true;
+    if (!posted) {
+        post();
+    }
+}
+
+// Post the completion task, must be called with interrupts disabled or from
+// an interrupt handler
+void CompletionSource::post() {
+    posted = true;
+    posts++;
+    minar::Scheduler::postCallback(FunctionPointer0<void>(&CompletionSource::run).bind());
+}
+
+void CompletionSource::run() {
+    // sources signalled from now on need another run
+    posted = false;
+    __DMB();
+    CompletionSource *source = sources;
+    while (source != NULL) {
+        if (!source->_signalled) {
+            source = source->_next;
+            continue;
+        }
+        source->_signalled = false;
+        __DMB();
+        uint32_t before = generation;
+        source->run_completions();
+        // a completion may have created or destroyed sources, even this one
+        source = before == generation ? source->_next : sources;
+    }
+}
+
+} // namespace mbed
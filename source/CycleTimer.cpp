@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/CycleTimer.h"
+#include "mbed-drivers/wait_api.h"
+
+namespace mbed {
+
+bool CycleTimer::_initialised = false;
+bool CycleTimer::_use_dwt = false;
+uint32_t CycleTimer::_frequency = 0;
+uint32_t CycleTimer::_ns_mult = 0;
+uint32_t CycleTimer::_counts_mult = 0;
+uint8_t CycleTimer::_ns_shift = 0;
+uint8_t CycleTimer::_counts_shift = 0;
+
+CycleTimer::CycleTimer() : _running(), _start(), _counts() {
+    init();
+    reset();
+}
+
+void CycleTimer::start() {
+    if (!_running) {
+        _start = now();
+        _running = 1;
+    }
+}
+
+void CycleTimer::stop() {
+    _counts += slicecounts();
+    _running = 0;
+}
+
+void CycleTimer::reset() {
+    _start = now();
+    _counts = 0;
+}
+
+uint64_t CycleTimer::read_counts() {
+    return _counts + slicecounts();
+}
+
+uint64_t CycleTimer::read_ns() {
+    // in two steps, so that the 32-bit conversion can't overflow
+    uint64_t counts = read_counts();
+    uint64_t seconds = counts / _frequency;
+    return seconds * 1000000000u + counts_to_ns(counts - seconds * _frequency);
+}
+
+float CycleTimer::read() {
+    return (float)read_counts() / (float)_frequency;
+}
+
+uint32_t CycleTimer::slicecounts() {
+    if (_running) {
+        return now() - _start;
+    } else {
+        return 0;
+    }
+}
+
+void CycleTimer::init() {
+    if (_initialised) {
+        return;
+    }
+#if MBED_CYCLETIMER_DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    if (!(DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk)) {
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        _use_dwt = true;
+    }
+    _frequency = _use_dwt ? SystemCoreClock : 1000000;
+#elif MBED_CYCLETIMER_POSIX
+    _frequency = 1000000000;
+#else
+    _frequency = 1000000;
+#endif
+    scale(1000000000, _frequency, _ns_mult, _ns_shift);
+    scale(_frequency, 1000000000, _counts_mult, _counts_shift);
+    _initialised = true;
+}
+
+// Find the fixed point factor closest to num / den which fits on 32 bits
+void CycleTimer::scale(uint64_t num, uint64_t den, uint32_t &mult, uint8_t &shift) {
+    shift = 32;
+    while (shift > 0 && (num << shift) / den > 0xFFFFFFFFu) {
+        shift--;
+    }
+    mult = (num << shift) / den;
+}
+
+} // namespace mbed
+
+void wait_ns(unsigned int ns) {
+    mbed::CycleTimer::init();
+    uint32_t counts = mbed::CycleTimer::ns_to_counts(ns);
+    uint32_t start = mbed::CycleTimer::now();
+    while ((mbed::CycleTimer::now() - start) < counts);
+}
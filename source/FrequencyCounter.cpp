@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/FrequencyCounter.h"
+
+#if DEVICE_INTERRUPTIN
+
+#include "core-util/CriticalSectionLock.h"
+
+namespace mbed {
+
+using namespace mbed::util;
+
+FrequencyCounter::FrequencyCounter(InterruptIn &input, timestamp_t gate_us, int averaging) :
+    _input(input), _gate(input._ticker_data), _gate_us(gate_us), _averaging(averaging),
+    _next(0), _windows(0), _sum_edges(0), _sum_span(0), _last_count(0), _last_time(0) {
+    if (_averaging < 1) {
+        _averaging = 1;
+    } else if (_averaging > YOTTA_CFG_MBED_DRIVERS_FREQUENCY_COUNTER_MAX_AVERAGING) {
+        _averaging = YOTTA_CFG_MBED_DRIVERS_FREQUENCY_COUNTER_MAX_AVERAGING;
+    }
+}
+
+void FrequencyCounter::start() {
+    _gate.detach();
+    _next = 0;
+    _windows = 0;
+    _sum_edges = 0;
+    _sum_span = 0;
+    _input.count();
+    {
+        CriticalSectionLock lock;
+        _last_count = _input.edge_count();
+        _last_time = ticker_read(_input._ticker_data);
+    }
+    _gate.attach_us(this, &FrequencyCounter::sample, _gate_us);
+}
+
+void FrequencyCounter::stop() {
+    _gate.detach();
+    _input.count_stop();
+}
+
+// Called by the gate Ticker at the end of each window
+void FrequencyCounter::sample() {
+    uint32_t count = _input.edge_count();
+    timestamp_t now = ticker_read(_input._ticker_data);
+    uint32_t edges = count - _last_count;
+    uint32_t span = now - _last_time;
+
+    _last_count = count;
+    _last_time = now;
+    if (_windows == _averaging) {
+        _sum_edges -= _edges[_next];
+        _sum_span -= _spans[_next];
+    } else {
+        _windows++;
+    }
+    _edges[_next] = edges;
+    _spans[_next] = span;
+    _sum_edges += edges;
+    _sum_span += span;
+    _next = (_next + 1) % _averaging;
+}
+
+void FrequencyCounter::read_count(uint32_t *edges, uint32_t *span_us) {
+    CriticalSectionLock lock;
+    *edges = _sum_edges;
+    *span_us = _sum_span;
+}
+
+float FrequencyCounter::read() {
+    uint32_t edges, span;
+
+    read_count(&edges, &span);
+    if (span == 0) {
+        return 0.0f;
+    }
+    return edges * 1000000.0f / span;
+}
+
+} // namespace mbed
+
+#endif
@@ -122,7 +122,11 @@ void I2C::irq_handler_asynch(void)
 {
     int event = i2c_irq_handler_asynch(&_i2c);
     if (_current_transaction.callback && event) {
-        minar::Scheduler::postCallback(_current_transaction.callback.bind(_current_transaction.tx_buffer, _current_transaction.rx_buffer, event));
+        transaction_data_t completion = _current_transaction;
+        completion.event = event;
+        if (!_completions.post(completion)) {
+            minar::Scheduler::postCallback(_current_transaction.callback.bind(_current_transaction.tx_buffer, _current_transaction.rx_buffer, event));
+        }
     }
 
 }
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/InlineCallChain.h"
+#include "mbed-drivers/mbed_assert.h"
+
+namespace mbed {
+
+CallChainArena::CallChainArena(int capacity) : _slots(), _next(), _spare(), _capacity(capacity), _owned(true) {
+    MBED_ASSERT(capacity >= 0 && capacity <= 254);
+    _slots = new mbed::util::FunctionPointer[capacity];
+    _next = new uint8_t[capacity];
+    _spare = new uint8_t[capacity];
+    init_slots();
+}
+
+CallChainArena::CallChainArena(mbed::util::FunctionPointer *slots, volatile uint8_t *next, uint8_t *spare, int capacity) :
+    _slots(slots), _next(next), _spare(spare), _capacity(capacity), _owned(false) {
+    MBED_ASSERT(capacity >= 0 && capacity <= 254);
+    init_slots();
+}
+
+CallChainArena::~CallChainArena() {
+    if (_owned) {
+        delete[] _slots;
+        delete[] _next;
+        delete[] _spare;
+    }
+}
+
+void CallChainArena::init_slots() {
+    _free = (_capacity > 0) ? 0 : NONE;
+    _available = _capacity;
+    _writer = 0;
+    for (int i = 0; i < _capacity; i++) {
+        _next[i] = NONE;
+        _spare[i] = (i + 1 < _capacity) ? i + 1 : NONE;
+    }
+}
+
+/* Writers exclude each other: interrupts are disabled, which is enough on
+ * a single core, and the flag is for hosts running several threads */
+void CallChainArena::lock() {
+    core_util_critical_section_enter();
+    uint8_t expected = 0;
+    while (!core_util_atomic_cas_u8(&_writer, &expected, 1)) {
+        expected = 0;
+    }
+}
+
+void CallChainArena::unlock() {
+    __DMB();
+    _writer = 0;
+    core_util_critical_section_exit();
+}
+
+InlineCallChain::InlineCallChain(int capacity) : _arena(new CallChainArena(capacity)), _owns_arena(true) {
+    init();
+}
+
+InlineCallChain::InlineCallChain(CallChainArena &arena) : _arena(&arena), _owns_arena(false) {
+    init();
+}
+
+InlineCallChain::~InlineCallChain() {
+    // give all the slots back to the arena, no call() may be running
+    _arena->lock();
+    for (uint8_t slot = _head; slot != NONE; slot = _next[slot]) {
+        _arena->_spare[slot] = _retired;
+        _retired = slot;
+    }
+    release(_retired);
+    _arena->unlock();
+    if (_owns_arena) {
+        delete _arena;
+    }
+}
+
+void InlineCallChain::init() {
+    _slots = _arena->_slots;
+    _next = _arena->_next;
+    _head = NONE;
+    _tail = NONE;
+    _retired = NONE;
+    _retired_count = 0;
+    _elements = 0;
+    _readers = 0;
+}
+
+/* Give a list of slots linked by _spare back to the arena */
+void InlineCallChain::release(uint8_t first) {
+    if (first == NONE) {
+        return;
+    }
+    uint8_t *spare = _arena->_spare;
+    uint8_t last = first;
+    _arena->_available++;
+    while (spare[last] != NONE) {
+        last = spare[last];
+        _arena->_available++;
+    }
+    spare[last] = _arena->_free;
+    _arena->_free = first;
+}
+
+/* Move the retired slots to the arena once no call() can be using them */
+void InlineCallChain::reclaim() {
+    // the unlinking of the retired slots must be visible before the readers are counted
+    __DMB();
+    if (_retired == NONE || _readers != 0) {
+        return;
+    }
+    release(_retired);
+    _retired = NONE;
+    _retired_count = 0;
+}
+
+/* Reclaim the slots retired while the last call() was running */
+void InlineCallChain::reclaim_unpinned() {
+    _arena->lock();
+    reclaim();
+    _arena->unlock();
+}
+
+pFunctionPointer_t InlineCallChain::get(int i) const {
+    if (i < 0 || i >= _elements)
+        return NULL;
+    uint8_t slot = _head;
+    while (i-- > 0)
+        slot = _next[slot];
+    return &_slots[slot];
+}
+
+int InlineCallChain::find(pFunctionPointer_t f) const {
+    int i = 0;
+    for (uint8_t slot = _head; slot != NONE; slot = _next[slot], i++)
+        if (&_slots[slot] == f)
+            return i;
+    return -1;
+}
+
+void InlineCallChain::clear() {
+    _arena->lock();
+    // the slots keep their links, for the calls still running
+    for (uint8_t slot = _head; slot != NONE; slot = _next[slot]) {
+        _arena->_spare[slot] = _retired;
+        _retired = slot;
+        _retired_count++;
+    }
+    _head = NONE;
+    _tail = NONE;
+    _elements = 0;
+    reclaim();
+    _arena->unlock();
+}
+
+bool InlineCallChain::remove(pFunctionPointer_t f) {
+    _arena->lock();
+    uint8_t prev = NONE;
+    uint8_t slot = _head;
+    while (slot != NONE && &_slots[slot] != f) {
+        prev = slot;
+        slot = _next[slot];
+    }
+    if (slot == NONE) {
+        _arena->unlock();
+        return false;
+    }
+    // unlink, leaving the slot's own link for the calls still running
+    if (prev == NONE) {
+        _head = _next[slot];
+    } else {
+        _next[prev] = _next[slot];
+    }
+    if (_tail == slot) {
+        _tail = prev;
+    }
+    _elements --;
+    _arena->_spare[slot] = _retired;
+    _retired = slot;
+    _retired_count++;
+    reclaim();
+    _arena->unlock();
+    return true;
+}
+
+pFunctionPointer_t InlineCallChain::common_add(const mbed::util::FunctionPointer &function, bool front) {
+    _arena->lock();
+    if (_arena->_free == NONE) {
+        reclaim();
+    }
+    uint8_t slot = _arena->_free;
+    if (slot == NONE) {
+        _arena->unlock();
+        return NULL;
+    }
+    _arena->_free = _arena->_spare[slot];
+    _arena->_available--;
+    _slots[slot] = function;
+    _next[slot] = front ? _head : NONE;
+    // the slot must be complete before a call() can reach it
+    __DMB();
+    if (front) {
+        _head = slot;
+        if (_tail == NONE) {
+            _tail = slot;
+        }
+    } else {
+        if (_tail == NONE) {
+            _head = slot;
+        } else {
+            _next[_tail] = slot;
+        }
+        _tail = slot;
+    }
+    _elements ++;
+    _arena->unlock();
+    return &_slots[slot];
+}
+
+} // namespace mbed
@@ -18,18 +18,81 @@
 
 #if DEVICE_INTERRUPTIN
 
+#include "mbed-drivers/Timeout.h"
+#include "mbed-drivers/CompletionQueue.h"
+#include "cmsis.h"
+#include "core-util/CriticalSectionLock.h"
+#include "core-util/critical.h"
+
 namespace mbed {
 
-InterruptIn::InterruptIn(PinName pin) : gpio(),
-                                        gpio_irq(),
-                                        _rise(),
-                                        _fall() {
+using namespace mbed::util;
+
+// The state of debounce() and rate_limit(), which the InterruptIns not using
+// them don't pay for
+struct InterruptIn::Filter {
+    Filter(int level, const ticker_data_t *data) : holdoff(data), settle_us(0), first_edge(0), level(level),
+                                                   max_edges(0), holdoff_us(0), window_start(0),
+                                                   window_edges(0), storms(0), masked(false) {
+    }
+
+    Timeout holdoff;            // ends the settle time, or a storm
+    timestamp_t settle_us;
+    timestamp_t first_edge;     // time of the edge which started the settle time
+    int level;                  // last settled level
+    uint32_t max_edges;
+    timestamp_t holdoff_us;
+    timestamp_t window_start;   // start of the millisecond edges are counted in
+    uint32_t window_edges;
+    volatile uint32_t storms;
+    bool masked;                // set while the interrupt is disabled
+};
+
+// Runs the delivery of the captured edges from the completion task,
+// allocated by the first capture
+struct InterruptIn::Delivery : public CompletionSource {
+    Delivery(InterruptIn *input) : input(input) {
+    }
+
+    // Have the edges delivered, with interrupts disabled or from the
+    // interrupt recording them
+    void post() {
+        signal();
+    }
+
+    InterruptIn *input;
+
+protected:
+    virtual void run_completions() {
+        input->deliver_edges();
+    }
+};
+
+InterruptIn::InterruptIn(PinName pin, const ticker_data_t *data) : gpio(),
+                                                                   gpio_irq(),
+                                                                   _ticker_data(data),
+                                                                   _rise(),
+                                                                   _fall(),
+                                                                   _capture(NULL),
+                                                                   _capture_size(0),
+                                                                   _capture_head(0),
+                                                                   _capture_tail(0),
+                                                                   _capture_overflows(0),
+                                                                   _capture_handler(),
+                                                                   _counting(false),
+                                                                   _count_rise(false),
+                                                                   _count_fall(false),
+                                                                   _edge_count(0),
+                                                                   _filter(NULL),
+                                                                   _delivery(NULL) {
     gpio_irq_init(&gpio_irq, pin, (&InterruptIn::_irq_handler), (uint32_t)this);
     gpio_init_in(&gpio, pin);
 }
 
 InterruptIn::~InterruptIn() {
     gpio_irq_free(&gpio_irq);
+    delete _filter;
+    delete _delivery;
 }
 
 int InterruptIn::read() {
@@ -43,34 +106,55 @@ void InterruptIn::mode(PinMode pull) {
 void InterruptIn::rise(void (*fptr)(void)) {
     if (fptr) {
         _rise.attach(fptr);
-        gpio_irq_set(&gpio_irq, IRQ_RISE, 1);
     } else {
         _rise.clear();
-        gpio_irq_set(&gpio_irq, IRQ_RISE, 0);
     }
+    update_irq();
 }
 
 void InterruptIn::fall(void (*fptr)(void)) {
     if (fptr) {
         _fall.attach(fptr);
-        gpio_irq_set(&gpio_irq, IRQ_FALL, 1);
     } else {
         _fall.clear();
-        gpio_irq_set(&gpio_irq, IRQ_FALL, 0);
     }
+    update_irq();
 }
 
 void InterruptIn::_irq_handler(uint32_t id, gpio_irq_event event) {
     InterruptIn *handler = (InterruptIn*)id;
+    if (NULL != handler->_filter) {
+        handler->filter_edge(event);
+        return;
+    }
+    // read the time first, as close to the edge as possible
+    timestamp_t timestamp = NULL != handler->_capture ? ticker_read(handler->_ticker_data) : 0;
+    handler->dispatch(event, timestamp);
+}
+
+// Report an edge to the current mode
+void InterruptIn::dispatch(gpio_irq_event event, timestamp_t timestamp) {
+    if (_counting) {
+        if ((event == IRQ_RISE && _count_rise) || (event == IRQ_FALL && _count_fall)) {
+            core_util_atomic_incr_u32((uint32_t *)&_edge_count, 1);
+        }
+        return;
+    }
+    if (NULL != _capture) {
+        if (event != IRQ_NONE) {
+            record_edge(timestamp, event == IRQ_RISE);
+        }
+        return;
+    }
     switch (event) {
         case IRQ_RISE:
-            if (handler->_rise) {
-                handler->_rise.call();
+            if (_rise) {
+                _rise.call();
             }
             break;
-        case IRQ_FALL: 
-            if (handler->_fall) {
-                handler->_fall.call();
+        case IRQ_FALL:
+            if (_fall) {
+                _fall.call();
             }
             break;
         case IRQ_NONE:
@@ -78,6 +162,223 @@ void InterruptIn::_irq_handler(uint32_t id, gpio_irq_event event) {
     }
 }
 
+void InterruptIn::filter_edge(gpio_irq_event event) {
+    Filter *filter = _filter;
+    timestamp_t now = ticker_read(_ticker_data);
+
+    if (filter->max_edges != 0) {
+        if (now - filter->window_start >= 1000) {
+            filter->window_start = now;
+            filter->window_edges = 0;
+        }
+        if (++filter->window_edges > filter->max_edges) {
+            filter->storms++;
+            filter->first_edge = now;
+            filter->masked = true;
+            disable_irq();
+            filter->holdoff.attach_us(this, &InterruptIn::holdoff_expired, filter->holdoff_us);
+            return;
+        }
+    }
+    if (filter->settle_us != 0) {
+        filter->first_edge = now;
+        filter->masked = true;
+        disable_irq();
+        filter->holdoff.attach_us(this, &InterruptIn::holdoff_expired, filter->settle_us);
+        return;
+    }
+    dispatch(event, now);
+}
+
+// Called by the Timeout of the filter, once the input settled or the storm
+// holdoff is over
+void InterruptIn::holdoff_expired() {
+    Filter *filter = _filter;
+
+    filter->masked = false;
+    enable_irq();
+    if (filter->settle_us != 0) {
+        int level = read();
+        if (level != filter->level) {
+            filter->level = level;
+            if (NULL != _capture) {
+                // the edges are otherwise recorded from the pin interrupt,
+                // which may preempt this one or be preempted by it
+                CriticalSectionLock lock;
+                dispatch(level ? IRQ_RISE : IRQ_FALL, filter->first_edge);
+            } else {
+                dispatch(level ? IRQ_RISE : IRQ_FALL, filter->first_edge);
+            }
+        }
+    }
+}
+
+void InterruptIn::debounce(timestamp_t settle_us) {
+    if (settle_us != 0) {
+        Filter *filter = get_filter();
+        CriticalSectionLock lock;
+        filter->settle_us = settle_us;
+        filter->level = read();
+    } else if (NULL != _filter) {
+        _filter->settle_us = 0;
+        put_filter();
+    }
+    update_irq();
+}
+
+void InterruptIn::rate_limit(uint32_t max_edges, timestamp_t holdoff_us) {
+    if (max_edges != 0) {
+        Filter *filter = get_filter();
+        CriticalSectionLock lock;
+        filter->max_edges = max_edges;
+        filter->holdoff_us = holdoff_us;
+        filter->window_start = ticker_read(_ticker_data);
+        filter->window_edges = 0;
+    } else if (NULL != _filter) {
+        _filter->max_edges = 0;
+        put_filter();
+    }
+}
+
+uint32_t InterruptIn::storms() const {
+    Filter *filter = _filter;
+    return NULL != filter ? filter->storms : 0;
+}
+
+InterruptIn::Filter *InterruptIn::get_filter() {
+    if (NULL == _filter) {
+        _filter = new Filter(read(), _ticker_data);
+    }
+    return _filter;
+}
+
+// Free the filter once neither debouncing nor rate limiting use it
+void InterruptIn::put_filter() {
+    Filter *filter = _filter;
+    if (filter->settle_us != 0 || filter->max_edges != 0) {
+        return;
+    }
+    {
+        CriticalSectionLock lock;
+        _filter = NULL;
+        filter->holdoff.detach();
+        if (filter->masked) {
+            enable_irq();
+        }
+    }
+    delete filter;
+}
+
+bool InterruptIn::start_capture(Edge *buffer, uint32_t size, const capture_handler_t &handler) {
+    if (NULL == buffer || 0 == size || (size & (size - 1)) != 0) {
+        return false;
+    }
+    if (NULL == _delivery) {
+        _delivery = new Delivery(this);
+    }
+    {
+        CriticalSectionLock lock;
+        _capture = NULL;
+        // the edges waiting are dropped, the counters stay monotonic for a
+        // delivery in progress
+        _capture_tail = _capture_head;
+        _capture_size = size;
+        _capture_handler = handler;
+        _capture = buffer;
+        _counting = false;
+    }
+    update_irq();
+    return true;
+}
+
+void InterruptIn::capture_stop() {
+    {
+        CriticalSectionLock lock;
+        _capture = NULL;
+        _capture_tail = _capture_head;
+    }
+    update_irq();
+}
+
+void InterruptIn::count(bool rise, bool fall) {
+    {
+        CriticalSectionLock lock;
+        _capture = NULL;
+        _capture_tail = _capture_head;
+        _count_rise = rise;
+        _count_fall = fall;
+        _counting = true;
+    }
+    update_irq();
+}
+
+void InterruptIn::count_stop() {
+    _counting = false;
+    update_irq();
+}
+
+// Enable the edge interrupts the current mode needs
+void InterruptIn::update_irq() {
+    bool rise = _rise;
+    bool fall = _fall;
+
+    if (NULL != _capture || (NULL != _filter && _filter->settle_us != 0)) {
+        rise = fall = true;
+    } else if (_counting) {
+        rise = _count_rise;
+        fall = _count_fall;
+    }
+    gpio_irq_set(&gpio_irq, IRQ_RISE, rise ? 1 : 0);
+    gpio_irq_set(&gpio_irq, IRQ_FALL, fall ? 1 : 0);
+}
+
+// Record an edge, from the pin interrupt, or from the Timeout of the filter
+// with interrupts disabled: the ring has a single producer
+void InterruptIn::record_edge(timestamp_t timestamp, bool rise) {
+    uint32_t head = _capture_head;
+    if (head - _capture_tail == _capture_size) {
+        _capture_overflows++;
+        return;
+    }
+    Edge &edge = _capture[head & (_capture_size - 1)];
+    edge.timestamp = timestamp;
+    edge.rise = rise;
+    // the edge must be in place before the delivery task can see it
+    __DMB();
+    _capture_head = head + 1;
+    _delivery->post();
+}
+
+void InterruptIn::deliver_edges() {
+    Edge *buffer = _capture;
+    uint32_t size = _capture_size;
+    uint32_t tail = _capture_tail;
+    uint32_t head = _capture_head;
+
+    // only deliver the edges waiting now, so that a storm of edges doesn't
+    // keep the other tasks from running
+    while (NULL != buffer && tail != head) {
+        uint32_t first = tail & (size - 1);
+        uint32_t count = head - tail;
+        if (count > size - first) {
+            count = size - first;
+        }
+        _capture_handler.call(&buffer[first], count);
+        // stop if the handler stopped or restarted capture
+        if (_capture != buffer || _capture_tail != tail) {
+            break;
+        }
+        tail += count;
+        // the edges must be read before the interrupt can reuse their room
+        __DMB();
+        _capture_tail = tail;
+    }
+    CriticalSectionLock lock;
+    if (NULL != _capture && _capture_head != _capture_tail) {
+        _delivery->post();
+    }
+}
+
 void InterruptIn::enable_irq() {
     gpio_irq_enable(&gpio_irq);
 }
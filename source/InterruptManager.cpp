@@ -18,15 +18,17 @@
 #if defined(NVIC_NUM_VECTORS)
 
 #include "mbed-drivers/InterruptManager.h"
+#include "core-util/critical.h"
 #include <string.h>
 
-#define CHAIN_INITIAL_SIZE    4
-
 namespace mbed {
 
 typedef void (*pvoidf)(void);
 
 InterruptManager* InterruptManager::_instance = (InterruptManager*)NULL;
+uint16_t InterruptManager::_vectors[YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS];
+InlineCallChain* InterruptManager::_chains[YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS];
+volatile int InterruptManager::_count = 0;
 
 InterruptManager* InterruptManager::get() {
     if (NULL == _instance)
@@ -35,7 +37,6 @@ InterruptManager* InterruptManager::get() {
 }
 
 InterruptManager::InterruptManager() {
-    memset(_chains, 0, NVIC_NUM_VECTORS * sizeof(CallChain*));
 }
 
 void InterruptManager::destroy() {
@@ -49,59 +50,142 @@ void InterruptManager::destroy() {
 }
 
 InterruptManager::~InterruptManager() {
-    for(int i = 0; i < NVIC_NUM_VECTORS; i++)
-        if (NULL != _chains[i])
-            delete _chains[i];
+    // the chains give their slots back to the arena, so go first
+    for (int i = 0; i < _count; i++) {
+        delete _chains[i];
+        _chains[i] = (InlineCallChain*) NULL;
+    }
+    _count = 0;
 }
 
-bool InterruptManager::must_replace_vector(IRQn_Type irq) {
-    int irq_pos = get_irq_index(irq);
-
-    if (NULL == _chains[irq_pos]) {
-        _chains[irq_pos] = new CallChain(CHAIN_INITIAL_SIZE);
-        _chains[irq_pos]->add((pvoidf)NVIC_GetVector(irq));
-        return true;
+// Put a chain in the index, with interrupts disabled
+void InterruptManager::insert_chain(int irq_pos, InlineCallChain *chain) {
+    // the vectors of chained interrupts search the index, keep it sorted
+    int i = _count;
+    for (; i > 0 && _vectors[i - 1] > irq_pos; i--) {
+        _vectors[i] = _vectors[i - 1];
+        _chains[i] = _chains[i - 1];
     }
-    return false;
+    _vectors[i] = irq_pos;
+    _chains[i] = chain;
+    _count = _count + 1;
 }
 
-pFunctionPointer_t InterruptManager::add_common(void (*function)(void), IRQn_Type irq, bool front) {
-    int irq_pos = get_irq_index(irq);
-    bool change = must_replace_vector(irq);
+// Remove entry i from the index, with interrupts disabled
+void InterruptManager::unlink_chain(int i) {
+    for (; i < _count - 1; i++) {
+        _vectors[i] = _vectors[i + 1];
+        _chains[i] = _chains[i + 1];
+    }
+    _count = _count - 1;
+}
 
-    pFunctionPointer_t pf = front ? _chains[irq_pos]->add_front(function) : _chains[irq_pos]->add(function);
-    if (change)
-        NVIC_SetVector(irq, (uint32_t)&InterruptManager::static_irq_helper);
-    return pf;
+// If there's a single function left in a chain, switch the interrupt vector
+// to call that function directly. This way we save both time and space. A
+// chain which is being called can't be deleted, and is left for later.
+void InterruptManager::collapse_chains() {
+    for (int i = 0; i < _count; i++) {
+        InlineCallChain *chain = NULL;
+        core_util_critical_section_enter();
+        // the vector and the index change together, so that no new call()
+        // can start once the chain was seen idle
+        if (i < _count && _chains[i]->size() == 1 && !_chains[i]->calling() &&
+                NULL != _chains[i]->get(0)->get_function()) {
+            chain = _chains[i];
+            NVIC_SetVector((IRQn_Type)(_vectors[i] - NVIC_USER_IRQ_OFFSET), (uint32_t)chain->get(0)->get_function());
+            unlink_chain(i);
+            i--;
+        }
+        core_util_critical_section_exit();
+        delete chain;
+    }
 }
 
-bool InterruptManager::remove_handler(pFunctionPointer_t handler, IRQn_Type irq) {
+pFunctionPointer_t InterruptManager::add_common(const mbed::util::FunctionPointer &function, IRQn_Type irq, bool front) {
     int irq_pos = get_irq_index(irq);
-
-    if (NULL == _chains[irq_pos])
-        return false;
-    if (!_chains[irq_pos]->remove(handler))
-        return false;
-    // If there's a single function left in the chain, swith the interrupt vector
-    // to call that function directly. This way we save both time and space.
-    if (_chains[irq_pos]->size() == 1 && NULL != _chains[irq_pos]->get(0)->get_function()) {
-        NVIC_SetVector(irq, (uint32_t)_chains[irq_pos]->get(0)->get_function());
-        delete _chains[irq_pos];
-        _chains[irq_pos] = (CallChain*) NULL;
+    InlineCallChain *spare = NULL;
+    pFunctionPointer_t pf = NULL;
+
+    // chains which were running when they were left with a single handler
+    collapse_chains();
+
+    // The chain is looked up and changed, or built and put in the index,
+    // with interrupts disabled, so that the handlers added or removed by
+    // an interrupt in the meantime can't collapse it under our feet. Only
+    // the allocation of a new chain is done with interrupts enabled.
+    while (true) {
+        core_util_critical_section_enter();
+        InlineCallChain *chain = find_chain(irq_pos);
+        if (NULL != chain) {
+            pf = chain->common_add(function, front);
+        } else if (_count < YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS) {
+            if (NULL == spare) {
+                core_util_critical_section_exit();
+                spare = new InlineCallChain(_arena);
+                continue;
+            }
+            // the chain has both handlers before the vector can reach it
+            if (NULL != spare->add((pvoidf)NVIC_GetVector(irq)) &&
+                    NULL != (pf = spare->common_add(function, front))) {
+                insert_chain(irq_pos, spare);
+                NVIC_SetVector(irq, (uint32_t)&InterruptManager::static_irq_helper);
+                spare = NULL;
+            }
+        }
+        core_util_critical_section_exit();
+        break;
     }
-    return true;
+    // a chain which wasn't needed gives its slots back
+    delete spare;
+    return pf;
 }
 
-void InterruptManager::irq_helper() {
-    _chains[__get_IPSR()]->call();
+bool InterruptManager::remove_handler(pFunctionPointer_t handler, IRQn_Type irq) {
+    core_util_critical_section_enter();
+    InlineCallChain *chain = find_chain(get_irq_index(irq));
+    bool removed = NULL != chain && chain->remove(handler);
+    core_util_critical_section_exit();
+
+    if (removed)
+        collapse_chains();
+    return removed;
 }
 
 int InterruptManager::get_irq_index(IRQn_Type irq) {
     return (int)irq + NVIC_USER_IRQ_OFFSET;
 }
 
+int InterruptManager::find_index(int irq_pos) {
+    int low = 0, high = _count - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (_vectors[mid] == irq_pos)
+            return mid;
+        if (_vectors[mid] < irq_pos)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+    return -1;
+}
+
+void InterruptManager::call_chain(int irq_pos) {
+    // the chain is found and counted as running at once, so that an
+    // interrupt preempting us can't collapse it before call() starts
+    core_util_critical_section_enter();
+    InlineCallChain *chain = find_chain(irq_pos);
+    if (NULL != chain)
+        chain->pin();
+    core_util_critical_section_exit();
+
+    if (NULL != chain) {
+        chain->call();
+        chain->unpin();
+    }
+}
+
 void InterruptManager::static_irq_helper() {
-    InterruptManager::get()->irq_helper();
+    call_chain(__get_IPSR());
 }
 
 } // namespace mbed
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include "mbed-drivers/ProfileZone.h"
+#include "core-util/CriticalSectionLock.h"
+
+#ifdef YOTTA_GREENTEA_CLIENT_VERSION_STRING
+#include "greentea-client/test_env.h"
+#else
+#include "mbed-drivers/test_env.h"
+#endif
+
+namespace mbed {
+
+using namespace util;
+
+ProfileSite *ProfileRegistry::_first = NULL;
+
+void ProfileRegistry::add(ProfileSite &site) {
+    CycleTimer::init();
+
+    CriticalSectionLock lock;
+    if (!site.registered) {
+        site.next = _first;
+        _first = &site;
+        site.registered = true;
+    }
+}
+
+void ProfileRegistry::record(ProfileSite &site, uint32_t counts) {
+    CriticalSectionLock lock;
+    site.count++;
+    site.total += counts;
+    if (counts < site.min) {
+        site.min = counts;
+    }
+    if (counts > site.max) {
+        site.max = counts;
+    }
+}
+
+void ProfileRegistry::reset() {
+    CriticalSectionLock lock;
+    for (ProfileSite *site = _first; site != NULL; site = site->next) {
+        site->count = 0;
+        site->min = 0xFFFFFFFFu;
+        site->max = 0;
+        site->total = 0;
+    }
+}
+
+/* Copy a site's statistics, converted to nano-seconds */
+static void read_site(const ProfileSite &site, uint32_t &count, uint32_t &min, uint32_t &max, uint32_t &mean) {
+    uint64_t total;
+    {
+        CriticalSectionLock lock;
+        count = site.count;
+        min = site.min;
+        max = site.max;
+        total = site.total;
+    }
+    if (count == 0) {
+        min = max = mean = 0;
+        return;
+    }
+    min = CycleTimer::counts_to_ns(min);
+    max = CycleTimer::counts_to_ns(max);
+    mean = CycleTimer::counts_to_ns((uint32_t)(total / count));
+}
+
+static void send_kv(const char *name, const char *kind, uint32_t value) {
+    char key[48];
+
+    snprintf(key, sizeof(key), "%s_%s", name, kind);
+#ifdef YOTTA_GREENTEA_CLIENT_VERSION_STRING
+    greentea_send_kv(key, (int)value);
+#else
+    notify_performance_coefficient(key, (unsigned int)value);
+#endif
+}
+
+void ProfileRegistry::report() {
+    uint32_t count, min, max, mean;
+
+    for (ProfileSite *site = _first; site != NULL; site = site->next) {
+        read_site(*site, count, min, max, mean);
+        send_kv(site->name, "count", count);
+        send_kv(site->name, "min_ns", min);
+        send_kv(site->name, "max_ns", max);
+        send_kv(site->name, "mean_ns", mean);
+    }
+}
+
+void ProfileRegistry::print() {
+    uint32_t count, min, max, mean;
+
+    printf("%-24s %10s %10s %10s %10s\r\n", "zone", "count", "min ns", "max ns", "mean ns");
+    for (ProfileSite *site = _first; site != NULL; site = site->next) {
+        read_site(*site, count, min, max, mean);
+        printf("%-24s %10lu %10lu %10lu %10lu\r\n", site->name, (unsigned long)count,
+               (unsigned long)min, (unsigned long)max, (unsigned long)mean);
+    }
+}
+
+} // namespace mbed
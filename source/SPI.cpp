@@ -18,17 +18,60 @@
 #include "minar/minar.h"
 #include "mbed-drivers/mbed_assert.h"
 #include "core-util/CriticalSectionLock.h"
+#include "PeripheralPins.h"
 
 #if DEVICE_SPI
 namespace mbed {
 
 using namespace util;
 
-#if DEVICE_SPI_ASYNCH && TRANSACTION_QUEUE_SIZE_SPI
-CircularBuffer<SPI::transaction_t, TRANSACTION_QUEUE_SIZE_SPI> SPI::_transaction_buffer;
+SPI::Bus *SPI::_buses = NULL;
+
+SPI::Bus::Bus(uint32_t peripheral) :
+        peripheral(peripheral),
+        next(NULL),
+        owner(NULL)
+#if DEVICE_SPI_ASYNCH
+        ,
+        transactions(TRANSACTION_QUEUE_SIZE_SPI ? new transaction_t[TRANSACTION_QUEUE_SIZE_SPI] : NULL),
+        size(TRANSACTION_QUEUE_SIZE_SPI),
+        head(0),
+        depth(0),
+        high_water(0),
+        overflows(0),
+        busy(false)
 #endif
+{
+}
+
+// Get the state of the physical SPI peripheral of the pins, allocated the
+// first time the peripheral is used
+SPI::Bus *SPI::get_bus(PinName mosi, PinName miso, PinName sclk)
+{
+    uint32_t spi_mosi = pinmap_peripheral(mosi, PinMap_SPI_MOSI);
+    uint32_t spi_miso = pinmap_peripheral(miso, PinMap_SPI_MISO);
+    uint32_t spi_sclk = pinmap_peripheral(sclk, PinMap_SPI_SCLK);
+    uint32_t peripheral = pinmap_merge(pinmap_merge(spi_mosi, spi_miso), spi_sclk);
+
+    // SPI objects are created from threads, only the list is shared with
+    // the interrupt handlers
+    Bus *bus;
+    for (bus = _buses; bus != NULL; bus = bus->next) {
+        if (bus->peripheral == peripheral) {
+            return bus;
+        }
+    }
+    bus = new Bus(peripheral);
+    {
+        CriticalSectionLock lock;
+        bus->next = _buses;
+        _buses = bus;
+    }
+    return bus;
+}
 
 SPI::SPI(PinName mosi, PinName miso, PinName sclk) :
+        _bus(get_bus(mosi, miso, sclk)),
         _spi(),
 #if DEVICE_SPI_ASYNCH
         _irq(this),
@@ -41,30 +84,38 @@ SPI::SPI(PinName mosi, PinName miso, PinName sclk) :
     spi_init(&_spi, mosi, miso, sclk);
     spi_format(&_spi, _bits, _mode, _order);
     spi_frequency(&_spi, _hz);
+    // spi_init() may have changed the format of the peripheral
+    _bus->owner = this;
+}
+
+SPI::~SPI() {
+    CriticalSectionLock lock;
+    if (_bus->owner == this) {
+        _bus->owner = NULL;
+    }
 }
 
 void SPI::format(int bits, int mode, spi_bitorder_t order) {
     _bits = bits;
     _mode = mode;
     _order = order;
-    SPI::_owner = NULL; // Not that elegant, but works. rmeyer
+    _bus->owner = NULL;
     aquire();
 }
 
 void SPI::frequency(int hz) {
     _hz = hz;
-    SPI::_owner = NULL; // Not that elegant, but works. rmeyer
+    _bus->owner = NULL;
     aquire();
 }
 
-SPI* SPI::_owner = NULL;
-
-// ignore the fact there are multiple physical spis, and always update if it wasnt us last
+// update the format and frequency of the peripheral if another SPI object
+// of the same peripheral set them last
 void SPI::aquire() {
-     if (_owner != this) {
+    if (_bus->owner != this) {
         spi_format(&_spi, _bits, _mode, _order);
         spi_frequency(&_spi, _hz);
-        _owner = this;
+        _bus->owner = this;
     }
 }
 
@@ -80,8 +131,8 @@ int SPI::transfer(const SPI::SPITransferAdder &td)
     bool queue;
     {
         CriticalSectionLock lock;
-        queue = _busy;
-        _busy = true;
+        queue = _bus->busy;
+        _bus->busy = true;
     }
     if (queue || spi_active(&_spi)) {
         return queue_transfer(td._td);
@@ -93,17 +144,15 @@ int SPI::transfer(const SPI::SPITransferAdder &td)
 void SPI::abort_transfer()
 {
     spi_abort_asynch(&_spi);
-#if TRANSACTION_QUEUE_SIZE_SPI
     dequeue_transaction();
-#endif
 }
 
 
 void SPI::clear_transfer_buffer()
 {
-#if TRANSACTION_QUEUE_SIZE_SPI
-    _transaction_buffer.reset();
-#endif
+    CriticalSectionLock lock;
+    _bus->head = 0;
+    _bus->depth = 0;
 }
 
 void SPI::abort_all_transfers()
@@ -121,23 +170,64 @@ int SPI::set_dma_usage(DMAUsage usage)
     return  0;
 }
 
+uint32_t SPI::transfer_queue_depth() const
+{
+    return _bus->depth;
+}
+
+int SPI::set_transfer_queue_size(uint32_t size)
+{
+    // the queues are allocated and freed outside of the critical section
+    transaction_t *transactions = size ? new transaction_t[size] : NULL;
+    int result = -1;
+    {
+        CriticalSectionLock lock;
+        if (_bus->depth == 0) {
+            transaction_t *old = _bus->transactions;
+            _bus->transactions = transactions;
+            _bus->size = size;
+            _bus->head = 0;
+            transactions = old;
+            result = 0;
+        }
+    }
+    delete[] transactions;
+    return result;
+}
+
+uint32_t SPI::transfer_queue_high_water() const
+{
+    return _bus->high_water;
+}
+
+uint32_t SPI::transfer_queue_overflows() const
+{
+    return _bus->overflows;
+}
+
+void SPI::reset_transfer_queue_stats()
+{
+    CriticalSectionLock lock;
+    _bus->high_water = _bus->depth;
+    _bus->overflows = 0;
+}
+
 int SPI::queue_transfer(const transaction_data_t &td)
 {
-#if TRANSACTION_QUEUE_SIZE_SPI
     CriticalSectionLock lock;
     int result;
 
-    transaction_t transaction(this, td);
-    if (_transaction_buffer.full()) {
+    if (_bus->depth == _bus->size) {
+        _bus->overflows++;
         result = -1;
     } else {
-        _transaction_buffer.push(transaction);
+        _bus->transactions[(_bus->head + _bus->depth) % _bus->size] = transaction_t(this, td);
+        if (++_bus->depth > _bus->high_water) {
+            _bus->high_water = _bus->depth;
+        }
         result = 0;
     }
     return result;
-#else
-    return -1;
-#endif
 }
 
 void SPI::start_transfer(const transaction_data_t &td)
@@ -149,8 +239,6 @@ void SPI::start_transfer(const transaction_data_t &td)
             _irq.entry(), td.event, _usage);
 }
 
-#if TRANSACTION_QUEUE_SIZE_SPI
-
 void SPI::start_transaction(transaction_data_t *data)
 {
     start_transfer(*data);
@@ -162,8 +250,13 @@ void SPI::dequeue_transaction()
     bool dequeued;
     {
         CriticalSectionLock lock;
-        dequeued = _transaction_buffer.pop(t);
-        _busy = dequeued;
+        dequeued = _bus->depth > 0;
+        if (dequeued) {
+            t = _bus->transactions[_bus->head];
+            _bus->head = (_bus->head + 1) % _bus->size;
+            _bus->depth--;
+        }
+        _bus->busy = dequeued;
     }
 
     if (dequeued) {
@@ -173,21 +266,21 @@ void SPI::dequeue_transaction()
     }
 }
 
-#endif
-
 void SPI::irq_handler_asynch(void)
 {
     int event = spi_irq_handler_asynch(&_spi);
     if (_current_transaction.callback && (event & SPI_EVENT_ALL)) {
-        minar::Scheduler::postCallback(
-                _current_transaction.callback.bind(_current_transaction.tx_buffer, _current_transaction.rx_buffer,
-                        event & SPI_EVENT_ALL));
+        transaction_data_t completion = _current_transaction;
+        completion.event = event & SPI_EVENT_ALL;
+        if (!_completions.post(completion)) {
+            minar::Scheduler::postCallback(
+                    _current_transaction.callback.bind(_current_transaction.tx_buffer, _current_transaction.rx_buffer,
+                            event & SPI_EVENT_ALL));
+        }
     }
-#if TRANSACTION_QUEUE_SIZE_SPI
     if (event & (SPI_EVENT_ALL | SPI_EVENT_INTERNAL_TRANSFER_COMPLETE)) {
         dequeue_transaction();
     }
-#endif
 }
 
 SPI::SPITransferAdder::SPITransferAdder(SPI *owner) :
@@ -17,25 +17,143 @@
 #include "mbed-drivers/Ticker.h"
 
 #include "mbed-drivers/TimerEvent.h"
-#include "core-util/FunctionPointer.h"
+#include "mbed-drivers/CompletionQueue.h"
+#include "mbed-drivers/SPSCRing.h"
+#include "mbed-drivers/mbed_assert.h"
+#include "core-util/CriticalSectionLock.h"
 #include "ticker_api.h"
+#include "cmsis.h"
+
+/* Number of deferred calls run by the completion task before it yields */
+#define TICKER_DEFERRED_BATCH   8
 
 namespace mbed {
 
+using namespace util;
+
+// The deferred calls, queued by the timer interrupts and run by the
+// completion task
+class Ticker::DeferredCalls : public CompletionSource {
+public:
+    DeferredCalls() : _dropped(0) {
+    }
+
+    // Queue a call, with interrupts disabled: the interrupts of different
+    // tickers may preempt each other, and the ring has a single producer
+    void push(Ticker *ticker) {
+        if (!_calls.push(ticker)) {
+            _dropped++;
+        } else {
+            signal();
+        }
+    }
+
+    // Drop the calls of a Ticker, from the completion task or thread mode
+    void forget(Ticker *ticker) {
+        _calls.replace(ticker, NULL);
+    }
+
+    uint32_t dropped() const {
+        return _dropped;
+    }
+
+protected:
+    virtual void run_completions() {
+        Ticker *ticker;
+
+        for (unsigned i = 0; i < TICKER_DEFERRED_BATCH; i++) {
+            if (!_calls.pop(ticker)) {
+                return;
+            }
+            if (ticker != NULL) {
+                ticker->_function.call();
+            }
+        }
+        // let the other tasks run before the rest of the calls
+        CriticalSectionLock lock;
+        if (!_calls.empty()) {
+            signal();
+        }
+    }
+
+private:
+    SPSCRing<Ticker*, YOTTA_CFG_MBED_DRIVERS_TICKER_DEFERRED_QUEUE_SIZE> _calls;
+    volatile uint32_t _dropped;
+};
+
+Ticker::DeferredCalls Ticker::_deferred_calls;
+
 void Ticker::detach() {
     remove();
     _function.attach(0);
+    if (_deferred) {
+        forget_deferred_calls();
+    }
 }
 
-void Ticker::setup(timestamp_t t) {
+void Ticker::set_deferred(bool deferred) {
+    bool was_deferred = _deferred;
+    // the timer interrupt stops queueing calls before the queued ones go
+    _deferred = deferred;
+    if (was_deferred && !deferred) {
+        forget_deferred_calls();
+    }
+}
+
+// Drop the calls of this Ticker still in the queue. The completion task is
+// the only reader of the queue, so this must not run from an interrupt
+void Ticker::forget_deferred_calls() {
+    MBED_ASSERT(__get_IPSR() == 0);
+    _deferred_calls.forget(this);
+}
+
+void Ticker::setup(timestamp_t t, timestamp_t slack) {
     remove();
     _delay = t;
-    insert(_delay + ticker_read(_ticker_data));
+    _slack = slack;
+    _deadline = _delay + ticker_read(_ticker_data);
+    insert(_deadline, _slack);
 }
 
 void Ticker::handler() {
-    insert(event.timestamp + _delay);
-    _function.call();
+    // event.timestamp may have been pushed back by the slack, so count from
+    // the nominal deadline to avoid drifting
+    _deadline += _delay;
+
+    int late = (int)(ticker_read(_ticker_data) - _deadline);
+    if (late >= 0 && _delay != 0) {
+        // the next call is already due: we're running a period or more late
+        uint32_t missed = (uint32_t)late / _delay + 1;
+        _overruns++;
+        switch (_policy) {
+            case Skip:
+                _deadline += missed * _delay;
+                _missed += missed;
+                break;
+            case Realign:
+                _deadline += late + _delay;
+                _missed += missed;
+                break;
+            case CatchUp:
+            default:
+                break;
+        }
+    }
+    insert(_deadline, _slack);
+    call_function();
+}
+
+void Ticker::call_function() {
+    if (!_deferred) {
+        _function.call();
+    } else {
+        CriticalSectionLock lock;
+        _deferred_calls.push(this);
+    }
+}
+
+uint32_t Ticker::deferred_overflows() {
+    return _deferred_calls.dropped();
 }
 
 } // namespace mbed
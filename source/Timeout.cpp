@@ -18,8 +18,13 @@
 
 namespace mbed {
 
+void Timeout::setup_us64(us_timestamp_t t) {
+    remove();
+    insert_absolute_us64(ticker_read_us64(_ticker_data) + t);
+}
+
 void Timeout::handler() {
-    _function.call();
+    call_function();
 }
 
 } // namespace mbed
@@ -30,7 +30,7 @@ Timer::Timer(const ticker_data_t *const data) : _running(), _start(), _time(), _
 
 void Timer::start() {
     if (!_running) {
-        _start = ticker_read(_ticker_data);
+        _start = ticker_read_us64(_ticker_data);
         _running = 1;
     }
 }
@@ -41,27 +41,31 @@ void Timer::stop() {
 }
 
 int Timer::read_us() {
+    return (int)read_high_resolution_us();
+}
+
+us_timestamp_t Timer::read_high_resolution_us() {
     return _time + slicetime();
 }
 
 float Timer::read() {
-    return (float)read_us() / 1000000.0f;
+    return (float)read_high_resolution_us() / 1000000.0f;
 }
 
 int Timer::read_ms() {
-    return read_us() / 1000;
+    return (int)(read_high_resolution_us() / 1000);
 }
 
-int Timer::slicetime() {
+us_timestamp_t Timer::slicetime() {
     if (_running) {
-        return ticker_read(_ticker_data) - _start;
+        return ticker_read_us64(_ticker_data) - _start;
     } else {
         return 0;
     }
 }
 
 void Timer::reset() {
-    _start = ticker_read(_ticker_data);
+    _start = ticker_read_us64(_ticker_data);
     _time = 0;
 }
 
@@ -15,37 +15,154 @@
  * limitations under the License.
  */
 #include "mbed-drivers/TimerEvent.h"
+#include "mbed-drivers/TimerWheel.h"
 #include "cmsis.h"
+#include "device.h"
+#include "core-util/CriticalSectionLock.h"
 
 #include <stddef.h>
 #include "ticker_api.h"
+#include "mbed-drivers/ticker_api_ext.h"
 #include "us_ticker_api.h"
+#if DEVICE_LOWPOWERTIMER
+#include "lp_ticker_api.h"
+#endif
 
 namespace mbed {
 
-TimerEvent::TimerEvent() : event(), _ticker_data(get_us_ticker_data()) {
+using namespace util;
+
+// The low power ticker is only initialised by the first insert_lp()
+TimerEvent::TimerEvent() : event(), _ticker_data(get_us_ticker_data()), _wheel(NULL),
+                           _timestamp64(0), _far(false), _lp_data(NULL), _lp_deadline(0),
+                           _wheel_next(NULL), _wheel_pprev(NULL) {
+    ticker_set_handler(_ticker_data, (&TimerEvent::irq));
+}
+
+TimerEvent::TimerEvent(const ticker_data_t *data) : event(), _ticker_data(data), _wheel(NULL),
+                                                    _timestamp64(0), _far(false), _lp_data(NULL), _lp_deadline(0),
+                                                    _wheel_next(NULL), _wheel_pprev(NULL) {
     ticker_set_handler(_ticker_data, (&TimerEvent::irq));
 }
 
-TimerEvent::TimerEvent(const ticker_data_t *data) : event(), _ticker_data(data) {
+TimerEvent::TimerEvent(TimerWheel &wheel) : event(), _ticker_data(static_cast<TimerEvent &>(wheel)._ticker_data),
+                                            _wheel(&wheel), _timestamp64(0), _far(false), _lp_data(NULL),
+                                            _lp_deadline(0), _wheel_next(NULL), _wheel_pprev(NULL) {
     ticker_set_handler(_ticker_data, (&TimerEvent::irq));
 }
 
 void TimerEvent::irq(uint32_t id) {
     TimerEvent *timer_event = (TimerEvent*)id;
-    timer_event->handler();
+    timer_event->dispatch();
+}
+
+void TimerEvent::dispatch() {
+    if (_lp_data != NULL) {
+        // close to the deadline, switch to the accurate ticker
+        handover();
+    } else if (_far) {
+        // only an intermediate event, queue the next one
+        insert_absolute_us64(_timestamp64);
+    } else {
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+        timestamp_t start = ticker_read(_ticker_data);
+        handler();
+        ticker_record_handler_time(_ticker_data, ticker_read(_ticker_data) - start);
+#else
+        handler();
+#endif
+    }
 }
 
 TimerEvent::~TimerEvent() {
     remove();
 }
 
-// insert in to linked list
-void TimerEvent::insert(timestamp_t timestamp) {
-    ticker_insert_event(_ticker_data, &event, timestamp, (uint32_t)this);
+// insert in to linked list, or on the timer wheel. The wheel already shares
+// one interrupt between all the deadlines of a wheel tick, so slack only
+// applies to the linked list.
+void TimerEvent::insert(timestamp_t timestamp, timestamp_t slack) {
+    _far = false;
+    if (_wheel != NULL) {
+        if (_wheel->add(this, timestamp)) {
+            return;
+        }
+    } else if (insert_lp(timestamp)) {
+        return;
+    }
+    ticker_insert_event_slack(_ticker_data, &event, timestamp, slack, (uint32_t)this);
+}
+
+void TimerEvent::insert_absolute_us64(us_timestamp_t timestamp) {
+    us_timestamp_t now = ticker_read_us64(_ticker_data);
+
+    if (timestamp <= now) {
+        // already due, the 32-bit ticker can't tell hours ago from hours ahead
+        insert((timestamp_t)now);
+    } else if (timestamp - now > TICKER_KEEPALIVE_INTERVAL) {
+        insert((timestamp_t)(now + TICKER_KEEPALIVE_INTERVAL));
+        _timestamp64 = timestamp;
+        _far = true;
+    } else {
+        insert((timestamp_t)timestamp);
+    }
+}
+
+const ticker_data_t *TimerEvent::lp_ticker_data() const {
+    const ticker_data_t *lp_data = ticker_get_low_power(_ticker_data);
+#if DEVICE_LOWPOWERTIMER
+    if (lp_data == NULL && _ticker_data == get_us_ticker_data()) {
+        lp_data = get_lp_ticker_data();
+    }
+#endif
+    return lp_data;
+}
+
+bool TimerEvent::insert_lp(timestamp_t timestamp) {
+    const ticker_data_t *lp_data = lp_ticker_data();
+    if (lp_data == NULL) {
+        return false;
+    }
+    int delay = (int)(timestamp - ticker_read(_ticker_data));
+    if (delay < YOTTA_CFG_MBED_DRIVERS_LP_TICKER_THRESHOLD_US) {
+        return false;
+    }
+    if (lp_data->queue->event_handler != &TimerEvent::irq) {
+        ticker_set_handler(lp_data, (&TimerEvent::irq));
+    }
+    // The us ticker may not count in deep sleep, so the deadline is kept as
+    // a low power ticker time until the handover
+    timestamp_t margin = YOTTA_CFG_MBED_DRIVERS_LP_TICKER_HANDOVER_US + ((timestamp_t)delay >> 10);
+    CriticalSectionLock lock;
+    _lp_deadline = ticker_read(lp_data) + delay;
+    _lp_data = lp_data;
+    ticker_insert_event(lp_data, &event, _lp_deadline - margin, (uint32_t)this);
+    return true;
+}
+
+// Atomic, so that a remove() from a higher priority interrupt finds the
+// event on one ticker or the other
+void TimerEvent::handover() {
+    CriticalSectionLock lock;
+    int remaining = (int)(_lp_deadline - ticker_read(_lp_data));
+    if (remaining < 0) {
+        remaining = 0;
+    }
+    _lp_data = NULL;
+    ticker_insert_event(_ticker_data, &event, ticker_read(_ticker_data) + remaining, (uint32_t)this);
 }
 
 void TimerEvent::remove() {
+    if (_wheel != NULL) {
+        _wheel->cancel(this);
+    }
+    // the low power ticker interrupt may hand the event over meanwhile
+    CriticalSectionLock lock;
+    if (_lp_data != NULL) {
+        ticker_remove_event(_lp_data, &event);
+        _lp_data = NULL;
+        return;
+    }
     ticker_remove_event(_ticker_data, &event);
 }
 
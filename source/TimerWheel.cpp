@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/TimerWheel.h"
+#include "core-util/CriticalSectionLock.h"
+
+#include <stddef.h>
+#include "ticker_api.h"
+
+namespace mbed {
+
+using namespace util;
+
+namespace {
+// Index of the lowest set bit of a non-zero word
+inline unsigned lowest_set_bit(uint32_t v) {
+    static const uint8_t debruijn[32] = {
+        0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+        31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+    };
+    return debruijn[((v & (0u - v)) * 0x077CB531u) >> 27];
+}
+}
+
+TimerWheel::TimerWheel() : TimerEvent(), _slots(), _pending(), _now(0), _now_us(ticker_read(_ticker_data)),
+                           _count(0), _armed_tick(0), _armed(false), _running(false) {
+}
+
+TimerWheel::TimerWheel(const ticker_data_t *data) : TimerEvent(data), _slots(), _pending(), _now(0),
+                                                    _now_us(ticker_read(_ticker_data)), _count(0),
+                                                    _armed_tick(0), _armed(false), _running(false) {
+}
+
+bool TimerWheel::add(TimerEvent *te, timestamp_t timestamp) {
+    CriticalSectionLock lock;
+    timestamp_t now = ticker_read(_ticker_data);
+
+    if ((int)(timestamp - now) < (int)resolution()) {
+        return false;
+    }
+    if (_count == 0 && !_running) {
+        // Nothing on the wheel, so it hasn't been kept up to date
+        _now_us = now;
+    }
+    te->event.timestamp = timestamp;
+    link(te);
+    if (!_running) {
+        schedule();
+    }
+    return true;
+}
+
+void TimerWheel::cancel(TimerEvent *te) {
+    CriticalSectionLock lock;
+
+    if (te->_wheel_pprev != NULL) {
+        unlink(te);
+        if (_count == 0 && !_running) {
+            schedule();
+        }
+    }
+}
+
+void TimerWheel::handler() {
+    _armed = false;
+    int elapsed = (int)(ticker_read(_ticker_data) - _now_us);
+    if (elapsed >= 0) {
+        run(_now + ((uint32_t)elapsed >> SHIFT));
+    }
+    CriticalSectionLock lock;
+    schedule();
+}
+
+// Put te in the slot for its deadline. The level is picked from the number
+// of ticks left, like in a classic cascading timer wheel.
+void TimerWheel::link(TimerEvent *te) {
+    const uint32_t range = 1u << (LEVELS * SLOT_BITS);
+    int delta_us = (int)(te->event.timestamp - _now_us);
+    uint32_t delta = (delta_us <= 0) ? 0 : ((uint32_t)delta_us + resolution() - 1) >> SHIFT;
+    unsigned level = 0;
+
+    if (delta >= range) {
+        // Park it at the far end of the wheel, it'll be looked at again when
+        // that slot is cascaded
+        delta = range - 1;
+    }
+    while (level < LEVELS - 1 && delta >= (1u << ((level + 1) * SLOT_BITS))) {
+        level++;
+    }
+    unsigned slot = ((_now + delta) >> (level * SLOT_BITS)) & SLOT_MASK;
+    TimerEvent **head = &_slots[level][slot];
+
+    te->_wheel_next = *head;
+    if (*head != NULL) {
+        (*head)->_wheel_pprev = &te->_wheel_next;
+    }
+    *head = te;
+    te->_wheel_pprev = head;
+    _pending[level][slot / 32] |= 1u << (slot % 32);
+    _count++;
+}
+
+void TimerWheel::unlink(TimerEvent *te) {
+    TimerEvent **pprev = te->_wheel_pprev;
+
+    *pprev = te->_wheel_next;
+    if (te->_wheel_next != NULL) {
+        te->_wheel_next->_wheel_pprev = pprev;
+    }
+    te->_wheel_next = NULL;
+    te->_wheel_pprev = NULL;
+    _count--;
+
+    // If te was the last one in a wheel slot, mark the slot as empty
+    uintptr_t offset = (uintptr_t)pprev - (uintptr_t)&_slots[0][0];
+    if (*pprev == NULL && offset < sizeof(_slots)) {
+        unsigned index = offset / sizeof(_slots[0][0]);
+        _pending[index / SLOTS][(index % SLOTS) / 32] &= ~(1u << (index % 32));
+    }
+}
+
+// Move all the TimerEvents in a slot to list
+void TimerWheel::take(unsigned level, unsigned slot, TimerEvent *&list) {
+    list = _slots[level][slot];
+    _slots[level][slot] = NULL;
+    _pending[level][slot / 32] &= ~(1u << (slot % 32));
+    if (list != NULL) {
+        list->_wheel_pprev = &list;
+    }
+}
+
+// Process all the ticks up to and including target, jumping over the ones
+// with nothing to do
+void TimerWheel::run(uint32_t target) {
+    _running = true;
+    while ((int)(target - _now) >= 0) {
+        bool pending;
+        {
+            CriticalSectionLock lock;
+            uint32_t tick;
+            pending = next_pending(tick) && (int)(target - tick) >= 0;
+            advance(pending ? tick : target + 1);
+        }
+        if (!pending) {
+            break;
+        }
+        for (unsigned level = LEVELS - 1; level > 0; level--) {
+            if ((_now & ((1u << (level * SLOT_BITS)) - 1)) == 0) {
+                cascade(level);
+            }
+        }
+        expire();
+    }
+    _running = false;
+}
+
+void TimerWheel::advance(uint32_t tick) {
+    _now_us += (tick - _now) << SHIFT;
+    _now = tick;
+}
+
+// Spread the TimerEvents of the current slot of a level to the lower levels
+void TimerWheel::cascade(unsigned level) {
+    TimerEvent *list;
+    {
+        CriticalSectionLock lock;
+        take(level, (_now >> (level * SLOT_BITS)) & SLOT_MASK, list);
+    }
+    while (true) {
+        CriticalSectionLock lock;
+        TimerEvent *te = list;
+        if (te == NULL) {
+            break;
+        }
+        unlink(te);
+        link(te);
+    }
+}
+
+// Run the TimerEvents of the current tick, then move on to the next one
+void TimerWheel::expire() {
+    TimerEvent *list;
+    {
+        CriticalSectionLock lock;
+        take(0, _now & SLOT_MASK, list);
+        advance(_now + 1);
+    }
+    while (true) {
+        TimerEvent *te;
+        {
+            CriticalSectionLock lock;
+            te = list;
+            if (te == NULL) {
+                break;
+            }
+            unlink(te);
+        }
+        te->dispatch();
+    }
+}
+
+// Find the first tick from _now on with TimerEvents to run or to cascade
+bool TimerWheel::next_pending(uint32_t &tick) const {
+    bool found = false;
+
+    for (unsigned level = 0; level < LEVELS; level++) {
+        unsigned shift = level * SLOT_BITS;
+        uint32_t mask = (1u << shift) - 1;
+        // first tick at which the slots of this level are looked at
+        uint32_t first = (_now + mask) & ~mask;
+        int distance = next_slot(_pending[level], (first >> shift) & SLOT_MASK);
+        if (distance < 0) {
+            continue;
+        }
+        uint32_t t = first + ((uint32_t)distance << shift);
+        if (!found || (int)(t - tick) < 0) {
+            tick = t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Arm the ticker event for the next tick with work to do. Must be called
+// with interrupts disabled.
+void TimerWheel::schedule() {
+    uint32_t tick;
+
+    if (!next_pending(tick)) {
+        if (_armed) {
+            TimerEvent::remove();
+            _armed = false;
+        }
+        return;
+    }
+    if (_armed && _armed_tick == tick) {
+        return;
+    }
+    TimerEvent::remove();
+    TimerEvent::insert(_now_us + ((tick - _now) << SHIFT));
+    _armed_tick = tick;
+    _armed = true;
+}
+
+// Distance from start to the first non-empty slot in a level's bitmap,
+// going round the wheel, or -1 if the level is empty
+int TimerWheel::next_slot(const uint32_t *bits, unsigned start) {
+    for (unsigned d = 0; d < SLOTS; ) {
+        unsigned i = (start + d) & SLOT_MASK;
+        uint32_t w = bits[i / 32] >> (i % 32);
+        if (w != 0) {
+            d += lowest_set_bit(w);
+            return (d < SLOTS) ? (int)d : -1;
+        }
+        d += 32 - (i % 32);
+    }
+    return -1;
+}
+
+} // namespace mbed
@@ -18,7 +18,138 @@
 
 #include <time.h>
 #include "mbed-drivers/rtc_time.h"
+#include "mbed-drivers/ticker_api_ext.h"
 #include "us_ticker_api.h"
+#include "core-util/critical.h"
+#if DEVICE_LOWPOWERTIMER
+#include "lp_ticker_api.h"
+#endif
+
+#define RTC_RESYNC_US   ((us_timestamp_t)YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S * 1000000)
+
+/* The time is kept as a time in seconds at a point of a ticker, which is
+ * much cheaper to read than the RTC on many targets. The low power ticker
+ * keeps counting in deep sleep, unlike the us ticker. */
+#if DEVICE_LOWPOWERTIMER
+#define time_base_ticker()  get_lp_ticker_data()
+#else
+#define time_base_ticker()  get_us_ticker_data()
+#endif
+
+static time_t base_seconds;
+static us_timestamp_t base_us;
+static int base_valid;
+/* Changed whenever the base is, so that a resync which raced with another
+ * update can be dropped */
+static uint32_t base_generation;
+/* The last time returned, which the following ones never go below */
+static time_t last_seconds;
+static uint32_t last_microseconds;
+/* Set by set_time_ticker(), NULL for time_base_ticker() */
+static const ticker_data_t *base_ticker;
+
+/* The RTC, see attach_rtc() */
+#if DEVICE_RTC
+static time_t (*read_rtc)(void) = rtc_read;
+static void (*write_rtc)(time_t) = rtc_write;
+static void (*init_rtc)(void) = rtc_init;
+static int (*isenabled_rtc)(void) = rtc_isenabled;
+#else
+static time_t (*read_rtc)(void) = NULL;
+static void (*write_rtc)(time_t) = NULL;
+static void (*init_rtc)(void) = NULL;
+static int (*isenabled_rtc)(void) = NULL;
+#endif
+
+static const ticker_data_t *time_ticker(void) {
+    return base_ticker != NULL ? base_ticker : time_base_ticker();
+}
+
+/* Seconds at a point of the time base ticker according to the cache, must
+ * be called with interrupts disabled */
+static time_t time_cached(us_timestamp_t now) {
+    return base_seconds + (uint32_t)(now - base_us) / 1000000;
+}
+
+/* Move the cached time onto a reading of the RTC taken at now, must be
+ * called with interrupts disabled */
+static void time_resync(us_timestamp_t now, time_t rtc) {
+    time_t cached = time_cached(now);
+
+    if (!base_valid || rtc > cached) {
+        // the RTC has just ticked, or near enough
+        base_seconds = rtc;
+        base_us = now;
+        base_valid = 1;
+    } else if (rtc < cached) {
+        // the RTC is about to tick. The ticker ran fast, so this moves the
+        // time back: time_read() holds it until it catches up.
+        base_seconds = rtc;
+        base_us = now - 999999;
+    } else {
+        // both agree, move the base forward so that elapsed stays small
+        base_seconds = cached;
+        base_us += (us_timestamp_t)((uint32_t)(now - base_us) / 1000000) * 1000000;
+    }
+    base_generation++;
+}
+
+/* Read the RTC and the time base ticker together. The RTC can be slow to
+ * access, so this is called with interrupts enabled */
+static time_t rtc_sample(us_timestamp_t *now) {
+    if (isenabled_rtc != NULL && !isenabled_rtc()) {
+        if (init_rtc != NULL) {
+            init_rtc();
+        }
+        if (write_rtc != NULL) {
+            write_rtc(0);
+        }
+    }
+    time_t rtc = read_rtc();
+    *now = ticker_read_us64(time_ticker());
+    return rtc;
+}
+
+/* Get the current time from the cache, resynchronised with the RTC every
+ * YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S seconds */
+static time_t time_read(uint32_t *microseconds) {
+    core_util_critical_section_enter();
+    us_timestamp_t now = ticker_read_us64(time_ticker());
+    while (!base_valid || now - base_us >= RTC_RESYNC_US) {
+        if (read_rtc == NULL) {
+            // no RTC: only keep elapsed small
+            time_resync(now, base_valid ? time_cached(now) : 0);
+            break;
+        }
+        // read the RTC outside the critical section, and only publish the
+        // result if nothing else has moved the base in the meantime
+        uint32_t generation = base_generation;
+        core_util_critical_section_exit();
+        us_timestamp_t sampled;
+        time_t rtc = rtc_sample(&sampled);
+        core_util_critical_section_enter();
+        if (generation == base_generation) {
+            time_resync(sampled, rtc);
+        }
+        now = ticker_read_us64(time_ticker());
+    }
+    uint32_t elapsed = (uint32_t)(now - base_us);
+    time_t t = base_seconds + elapsed / 1000000;
+    uint32_t us = elapsed % 1000000;
+    if (t < last_seconds || (t == last_seconds && us < last_microseconds)) {
+        t = last_seconds;
+        us = last_microseconds;
+    } else {
+        last_seconds = t;
+        last_microseconds = us;
+    }
+    core_util_critical_section_exit();
+
+    if (microseconds != NULL) {
+        *microseconds = us;
+    }
+    return t;
+}
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,15 +161,7 @@ time_t time(time_t *timer)
 #endif
 
 {
-#if DEVICE_RTC
-    if (!(rtc_isenabled())) {
-        set_time(0);
-    }
-    time_t t = rtc_read();
-
-#else
-    time_t t = 0;
-#endif
+    time_t t = time_read(NULL);
 
     if (timer != NULL) {
         *timer = t;
@@ -46,17 +169,71 @@ time_t time(time_t *timer)
     return t;
 }
 
+time_t get_time_us(time_t *seconds, uint32_t *microseconds) {
+    uint32_t us;
+    time_t t = time_read(&us);
+
+    if (seconds != NULL) {
+        *seconds = t;
+    }
+    if (microseconds != NULL) {
+        *microseconds = us;
+    }
+    return t;
+}
+
 void set_time(time_t t) {
-#if DEVICE_RTC
-    rtc_init();
-    rtc_write(t);
-#endif
+    if (init_rtc != NULL) {
+        init_rtc();
+    }
+    if (write_rtc != NULL) {
+        write_rtc(t);
+    }
+    core_util_critical_section_enter();
+    base_seconds = t;
+    base_us = ticker_read_us64(time_ticker());
+    base_valid = 1;
+    base_generation++;
+    // the time may go back here, and only here
+    last_seconds = t;
+    last_microseconds = 0;
+    core_util_critical_section_exit();
+}
+
+void attach_rtc(time_t (*read)(void), void (*write)(time_t), void (*init)(void), int (*isenabled)(void)) {
+    core_util_critical_section_enter();
+    read_rtc = read;
+    write_rtc = write;
+    init_rtc = init;
+    isenabled_rtc = isenabled;
+    // read the new RTC at the next call
+    if (read_rtc != NULL) {
+        base_valid = 0;
+    }
+    base_generation++;
+    core_util_critical_section_exit();
+}
+
+void set_time_ticker(const ticker_data_t *data) {
+    uint32_t us;
+    time_t t = time_read(&us);
+
+    core_util_critical_section_enter();
+    base_ticker = data;
+    // go on from the current time on the new ticker
+    base_seconds = t;
+    base_us = ticker_read_us64(time_ticker()) - us;
+    base_generation++;
+    core_util_critical_section_exit();
 }
 
 clock_t clock() {
-    clock_t t = us_ticker_read();
-    t /= 1000000 / CLOCKS_PER_SEC; // convert to processor time
-    return t;
+    return (clock_t)clock64();
+}
+
+uint64_t clock64(void) {
+    // the 64-bit ticker time doesn't wrap, unlike us_ticker_read()
+    return ticker_read_us64(get_us_ticker_data()) / (1000000 / CLOCKS_PER_SEC); // convert to processor time
 }
 
 #ifdef __cplusplus
@@ -16,107 +16,587 @@
  */
 #include <stddef.h>
 #include "ticker_api.h"
+#include "mbed-drivers/ticker_api_ext.h"
 #include "cmsis.h"
 #include "core-util/critical.h"
 
-void ticker_set_handler(const ticker_data_t *const data, ticker_event_handler handler) {
-    data->interface->init();
+#include <string.h>
 
-    data->queue->event_handler = handler;
+#define TICKER_QUEUE_LANES          YOTTA_CFG_MBED_DRIVERS_TICKER_QUEUE_LANES
+/* Below this many events per lane the list walk is cheaper than keeping lanes */
+#define TICKER_QUEUE_MIN_SPACING    8
+
+/* The queue of every ticker_data_t must be embedded in a ticker_queue_t, which
+ * can't be checked here: see ticker_api_ext.h */
+static inline ticker_queue_t *get_queue(const ticker_data_t *const data) {
+    return (ticker_queue_t *)data->queue;
 }
 
-void ticker_irq_handler(const ticker_data_t *const data) {
-    data->interface->clear_interrupt();
+#if TICKER_QUEUE_LANES
 
-    /* Go through all the pending TimerEvents */
-    while (1) {
-        if (data->queue->head == NULL) {
-            // There are no more TimerEvents left, so disable matches.
-            data->interface->disable_interrupt();
-            return;
-        }
+/* Return the index of the last lane ordered before timestamp, or -1. With
+ * strict set, lanes with the same timestamp are not considered before it. */
+static int lane_search(const ticker_queue_t *q, timestamp_t timestamp, int strict) {
+    int lo = 0, hi = q->lane_count;
 
-        if ((int)(data->queue->head->timestamp - data->interface->read()) <= 0) {
-            // This event was in the past:
-            //      point to the following one and execute its handler
-            ticker_event_t *p = data->queue->head;
-            data->queue->head = data->queue->head->next;
-            if (data->queue->event_handler != NULL) {
-                (*data->queue->event_handler)(p->id); // NOTE: the handler can set new events
-            }
-            /* Note: We continue back to examining the head because calling the
-             * event handler may have altered the chain of pending events. */
+    if (q->flags & TICKER_QUEUE_FLAG_NO_INDEX) {
+        return -1;
+    }
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int delta = (int)(timestamp - q->lanes[mid]->timestamp);
+        if (delta > 0 || (!strict && delta == 0)) {
+            lo = mid + 1;
         } else {
-            // This event and the following ones in the list are in the future:
-            //      set it as next interrupt and return
-            data->interface->set_interrupt(data->queue->head->timestamp);
-            return;
+            hi = mid;
         }
     }
+    return lo - 1;
 }
 
-void ticker_insert_event(const ticker_data_t *const data, ticker_event_t *obj, timestamp_t timestamp, uint32_t id) {
-    /* disable interrupts for the duration of the function */
-    core_util_critical_section_enter();
+static void lane_insert(ticker_queue_t *q, int index, ticker_event_t *obj) {
+    if (q->lane_count == TICKER_QUEUE_LANES) {
+        /* Out of lanes: drop every other one and space them further apart.
+         * The next long walk will add the lane back. */
+        int i;
+        for (i = 0; 2 * i + 1 < TICKER_QUEUE_LANES; i++) {
+            q->lanes[i] = q->lanes[2 * i + 1];
+        }
+        q->lane_count = i;
+        q->spacing *= 2;
+        return;
+    }
+    for (int i = q->lane_count; i > index; i--) {
+        q->lanes[i] = q->lanes[i - 1];
+    }
+    q->lanes[index] = obj;
+    q->lane_count++;
+}
 
-    // initialise our data
-    obj->timestamp = timestamp;
-    obj->id = id;
+/* Space the lanes closer again once the queue has shrunk */
+static void lane_relax(ticker_queue_t *q) {
+    if (q->spacing > TICKER_QUEUE_MIN_SPACING && q->length < q->spacing * TICKER_QUEUE_LANES / 4) {
+        q->spacing /= 2;
+    }
+}
 
-    /* Go through the list until we either reach the end, or find
-       an element this should come before (which is possibly the
-       head). */
-    ticker_event_t *prev = NULL, *p = data->queue->head;
-    while (p != NULL) {
-        /* check if we come before p */
-        if ((int)(timestamp - p->timestamp) < 0) {
-            break;
+/* Called before obj is unlinked from the queue, moves or drops its lane */
+static void lane_unlink(ticker_queue_t *q, ticker_event_t *obj) {
+    int i = lane_search(q, obj->timestamp, 1) + 1;
+
+    for (; i < q->lane_count && q->lanes[i]->timestamp == obj->timestamp; i++) {
+        if (q->lanes[i] != obj) {
+            continue;
         }
-        /* go to the next element */
+        if (obj->next != NULL && (i + 1 == q->lane_count || q->lanes[i + 1] != obj->next)) {
+            q->lanes[i] = obj->next;
+        } else {
+            q->lane_count--;
+            for (; i < q->lane_count; i++) {
+                q->lanes[i] = q->lanes[i + 1];
+            }
+        }
+        break;
+    }
+    lane_relax(q);
+}
+
+/* Called after the expired events at the head of the queue were detached,
+ * drops their lanes */
+static void lane_drop_expired(ticker_queue_t *q, ticker_event_t *expired) {
+    int n = 0;
+
+    /* Lanes are in queue order, so the expired ones come first */
+    for (; expired != NULL && n < q->lane_count; expired = expired->next) {
+        if (q->lanes[n] == expired) {
+            n++;
+        }
+    }
+    if (n > 0) {
+        q->lane_count -= n;
+        for (int i = 0; i < q->lane_count; i++) {
+            q->lanes[i] = q->lanes[i + n];
+        }
+    }
+    lane_relax(q);
+}
+
+#else
+
+static inline int lane_search(const ticker_queue_t *q, timestamp_t timestamp, int strict) {
+    (void)q; (void)timestamp; (void)strict;
+    return -1;
+}
+
+static inline void lane_insert(ticker_queue_t *q, int index, ticker_event_t *obj) {
+    (void)q; (void)index; (void)obj;
+}
+
+static inline void lane_unlink(ticker_queue_t *q, ticker_event_t *obj) {
+    (void)q; (void)obj;
+}
+
+static inline void lane_drop_expired(ticker_queue_t *q, ticker_event_t *expired) {
+    (void)q; (void)expired;
+}
+
+#endif
+
+static inline ticker_event_t *lane_start(const ticker_queue_t *q, int lane) {
+#if TICKER_QUEUE_LANES
+    return (lane < 0) ? NULL : q->lanes[lane];
+#else
+    (void)q; (void)lane;
+    return NULL;
+#endif
+}
+
+/* Find the last event in the queue which is not after timestamp, i.e. the
+ * event a new one with this timestamp has to be linked after. Returns NULL if
+ * the new event goes at the head of the queue. The search starts from the
+ * closest lane, or from hint if it is closer; hint must be NULL or an event
+ * in the queue which is not after timestamp. */
+static ticker_event_t *queue_find_prev(ticker_queue_t *q, ticker_event_t *hint, timestamp_t timestamp) {
+    int lane = lane_search(q, timestamp, 0);
+    ticker_event_t *prev = lane_start(q, lane);
+    ticker_event_t *p;
+    ticker_event_t *split = NULL;
+    uint32_t steps = 0;
+
+    if (hint != NULL && (prev == NULL || (int)(hint->timestamp - prev->timestamp) > 0)) {
+        prev = hint;
+    }
+    p = (prev == NULL) ? q->queue.head : prev->next;
+
+    if (q->spacing < TICKER_QUEUE_MIN_SPACING) {
+        q->spacing = TICKER_QUEUE_MIN_SPACING;
+    }
+    while (p != NULL && (int)(timestamp - p->timestamp) >= 0) {
         prev = p;
         p = p->next;
+        if (++steps == q->spacing) {
+            split = prev;
+        }
     }
-    /* if prev is NULL we're at the head */
+    /* The walk was long: put a lane in the middle of this stretch */
+    if (split != NULL && !(q->flags & TICKER_QUEUE_FLAG_NO_INDEX)) {
+        lane_insert(q, lane + 1, split);
+    }
+    return prev;
+}
+
+/* Pick the timestamp in [timestamp, timestamp + slack] with the most trailing
+ * zero bits, so that events with overlapping windows tend to line up */
+static timestamp_t apply_slack(timestamp_t timestamp, timestamp_t slack) {
+    timestamp_t limit = timestamp + slack;
+    timestamp_t mask = timestamp ^ limit;
+
+    if (mask == 0) {
+        return timestamp;
+    }
+    /* keep the highest bit that differs between both ends of the window */
+    while (mask & (mask - 1)) {
+        mask &= mask - 1;
+    }
+    return limit & ~(mask - 1);
+}
+
+/* The keepalive event isn't counted in the queue length */
+static inline uint32_t event_weight(const ticker_queue_t *q, const ticker_event_t *obj) {
+    return (obj == &q->keepalive) ? 0 : 1;
+}
+
+static void queue_link(ticker_queue_t *q, ticker_event_t *prev, ticker_event_t *obj) {
     if (prev == NULL) {
-        data->queue->head = obj;
-        data->interface->set_interrupt(timestamp);
+        obj->next = q->queue.head;
+        q->queue.head = obj;
     } else {
+        obj->next = prev->next;
         prev->next = obj;
     }
-    /* if we're at the end p will be NULL, which is correct */
-    obj->next = p;
+    q->length += event_weight(q, obj);
+}
+
+static void queue_unlink(ticker_queue_t *q, ticker_event_t *prev, ticker_event_t *obj) {
+    lane_unlink(q, obj);
+    if (prev == NULL) {
+        q->queue.head = obj->next;
+    } else {
+        prev->next = obj->next;
+    }
+    q->length -= event_weight(q, obj);
+}
+
+/* Detach all the events due at now from the head of the queue, in order */
+static ticker_event_t *queue_detach_expired(ticker_queue_t *q, timestamp_t now) {
+    ticker_event_t *expired = q->queue.head;
+    ticker_event_t *last = NULL;
+    ticker_event_t *p = expired;
+
+    while (p != NULL && (int)(p->timestamp - now) <= 0) {
+        q->length -= event_weight(q, p);
+        last = p;
+        p = p->next;
+    }
+    if (last == NULL) {
+        return NULL;
+    }
+    last->next = NULL;
+    q->queue.head = p;
+    lane_drop_expired(q, expired);
+    return expired;
+}
+
+/* Remove obj from a plain list, returns 0 if it isn't in it */
+static int list_remove(ticker_event_t **list, ticker_event_t *obj) {
+    for (; *list != NULL; list = &(*list)->next) {
+        if (*list == obj) {
+            *list = obj->next;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* While the expired events are dispatched, new events are kept sorted in the
+ * short pending list instead of being inserted in the queue one by one */
+static void pending_insert(ticker_queue_t *q, ticker_event_t *obj) {
+    ticker_event_t **p = &q->pending;
 
+    while (*p != NULL && (int)(obj->timestamp - (*p)->timestamp) >= 0) {
+        p = &(*p)->next;
+    }
+    obj->next = *p;
+    *p = obj;
+}
+
+/* Move the pending events to the queue in a single pass over it */
+static void pending_merge(ticker_queue_t *q) {
+    ticker_event_t *prev = NULL;
+
+    while (q->pending != NULL) {
+        ticker_event_t *obj = q->pending;
+        q->pending = obj->next;
+        /* the pending list is sorted, so the search for the next event
+           resumes from the previous one */
+        prev = queue_find_prev(q, prev, obj->timestamp);
+        queue_link(q, prev, obj);
+        prev = obj;
+    }
+}
+
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+static void histogram_add(ticker_histogram_t *histogram, timestamp_t ticks) {
+    unsigned bucket = 0;
+
+    while (ticks != 0 && bucket < TICKER_HISTOGRAM_BUCKETS - 1) {
+        ticks >>= 1;
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+}
+#endif
+
+/* Insert an event, must be called with interrupts disabled */
+static void queue_insert(const ticker_data_t *const data, ticker_queue_t *q, ticker_event_t *obj,
+                         timestamp_t timestamp, timestamp_t slack, uint32_t id) {
+    ticker_event_t *prev = NULL;
+
+    if (slack != 0) {
+        /* Find the element this should come after, using the lane index to
+           skip most of the list. NULL means we go at the head. */
+        prev = queue_find_prev(q, NULL, timestamp);
+        ticker_event_t *p = (prev == NULL) ? q->queue.head : prev->next;
+        if (prev != NULL && prev->timestamp == timestamp) {
+            /* Already sharing the interrupt of the events before us: don't
+               round up away from it */
+        } else if (p != NULL && p->timestamp - timestamp <= slack) {
+            /* The next event is due within our window: fire along with it,
+               after the other events already sharing its timestamp */
+            timestamp = p->timestamp;
+            while (p->next != NULL && p->next->timestamp == timestamp) {
+                p = p->next;
+            }
+            prev = p;
+            q->stats.coalesced++;
+        } else {
+            /* Nothing due before timestamp + slack, so rounding up doesn't
+               change our place in the list */
+            timestamp = apply_slack(timestamp, slack);
+        }
+    }
+
+    // initialise our data
+    obj->timestamp = timestamp;
+    obj->id = id;
+
+    if (q->flags & TICKER_QUEUE_FLAG_DISPATCHING) {
+        /* ticker_irq_handler() merges it in and sets the interrupt */
+        pending_insert(q, obj);
+        return;
+    }
+    if (slack == 0) {
+        prev = queue_find_prev(q, NULL, timestamp);
+    }
+    queue_link(q, prev, obj);
+    if (prev == NULL) {
+        data->interface->set_interrupt(timestamp);
+    }
+}
+
+/* Extend a ticker reading to 64 bits, must be called at least once per wrap
+ * of the ticker, with interrupts disabled since the ticker was read: a newer
+ * reading stored in between would be counted as a wrap */
+static us_timestamp_t update_time(ticker_queue_t *q, timestamp_t now) {
+    if (now < q->last_read) {
+        q->wraps++;
+    }
+    q->last_read = now;
+    return ((us_timestamp_t)q->wraps << 32) | now;
+}
+
+/* (Re)queue the keepalive event, must be called with interrupts disabled */
+static void keepalive_insert(const ticker_data_t *const data, ticker_queue_t *q) {
+    timestamp_t now = data->interface->read();
+    update_time(q, now);
+    queue_insert(data, q, &q->keepalive, now + TICKER_KEEPALIVE_INTERVAL, 0, 0);
+}
+
+static void keepalive_start(const ticker_data_t *const data, ticker_queue_t *q) {
+    if (!(q->flags & TICKER_QUEUE_FLAG_KEEPALIVE)) {
+        q->flags |= TICKER_QUEUE_FLAG_KEEPALIVE;
+        keepalive_insert(data, q);
+    }
+}
+
+void ticker_set_handler(const ticker_data_t *const data, ticker_event_handler handler) {
+    data->interface->init();
+
+    core_util_critical_section_enter();
+    data->queue->event_handler = handler;
+    keepalive_start(data, get_queue(data));
+    core_util_critical_section_exit();
+}
+
+void ticker_irq_handler(const ticker_data_t *const data) {
+    ticker_queue_t *q = get_queue(data);
+
+    data->interface->clear_interrupt();
+
+    /* The ticker is read once per batch of expired events rather than once
+     * per event. The last read, which finds nothing left to run, also ends
+     * the measured interrupt duration. */
+    core_util_critical_section_enter();
+    timestamp_t start = data->interface->read();
+    timestamp_t now = start;
+
+    while (1) {
+        update_time(q, now);
+        q->expired = queue_detach_expired(q, now);
+        if (q->expired == NULL) {
+            if (q->queue.head == NULL) {
+                // There are no more TimerEvents left, so disable matches.
+                data->interface->disable_interrupt();
+            } else {
+                // The following events are in the future:
+                //      set the first one as next interrupt
+                data->interface->set_interrupt(q->queue.head->timestamp);
+            }
+            core_util_critical_section_exit();
+            break;
+        }
+        q->flags |= TICKER_QUEUE_FLAG_DISPATCHING;
+        core_util_critical_section_exit();
+
+        /* Run the batch. Handlers may insert events, which are put aside in
+         * the pending list, or remove events, including the expired ones
+         * which haven't run yet. */
+        while (1) {
+            core_util_critical_section_enter();
+            ticker_event_t *p = q->expired;
+            if (p == NULL) {
+                core_util_critical_section_exit();
+                break;
+            }
+            q->expired = p->next;
+            q->stats.irq_events++;
+            if (p == &q->keepalive) {
+                keepalive_insert(data, q);
+                p = NULL;
+            }
+            core_util_critical_section_exit();
+
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+            if (p != NULL) {
+                histogram_add(&q->latency, data->interface->read() - p->timestamp);
+            }
+#endif
+            if (p != NULL && p != &q->wakeup && q->queue.event_handler != NULL) {
+                (*q->queue.event_handler)(p->id); // NOTE: the handler can set new events
+            }
+        }
+
+        core_util_critical_section_enter();
+        q->flags &= ~TICKER_QUEUE_FLAG_DISPATCHING;
+        pending_merge(q);
+
+        /* Running the handlers took time: look for events which are now due */
+        now = data->interface->read();
+    }
+
+    timestamp_t duration = now - start;
+    q->stats.irqs++;
+    q->stats.irq_ticks += duration;
+    if (duration > q->stats.irq_ticks_max) {
+        q->stats.irq_ticks_max = duration;
+    }
+}
+
+void ticker_insert_event(const ticker_data_t *const data, ticker_event_t *obj, timestamp_t timestamp, uint32_t id) {
+    ticker_insert_event_slack(data, obj, timestamp, 0, id);
+}
+
+void ticker_insert_event_slack(const ticker_data_t *const data, ticker_event_t *obj, timestamp_t timestamp,
+                               timestamp_t slack, uint32_t id) {
+    /* disable interrupts for the duration of the function */
+    core_util_critical_section_enter();
+    queue_insert(data, get_queue(data), obj, timestamp, slack, id);
     core_util_critical_section_exit();
 }
 
+void ticker_insert_wakeup(const ticker_data_t *const data, timestamp_t timestamp) {
+    ticker_queue_t *q = get_queue(data);
+    ticker_insert_event(data, &q->wakeup, timestamp, 0);
+}
+
+void ticker_remove_wakeup(const ticker_data_t *const data) {
+    ticker_queue_t *q = get_queue(data);
+    ticker_remove_event(data, &q->wakeup);
+}
+
 void ticker_remove_event(const ticker_data_t *const data, ticker_event_t *obj) {
+    ticker_queue_t *q = get_queue(data);
+
     core_util_critical_section_enter();
 
     // remove this object from the list
-    if (data->queue->head == obj) {
+    if (q->queue.head == obj) {
         // first in the list, so just drop me
-        data->queue->head = obj->next;
-        if (data->queue->head == NULL) {
+        queue_unlink(q, NULL, obj);
+        if (q->flags & TICKER_QUEUE_FLAG_DISPATCHING) {
+            // ticker_irq_handler() sets the interrupt when it's done
+        } else if (q->queue.head == NULL) {
             data->interface->disable_interrupt();
         } else {
-            data->interface->set_interrupt(data->queue->head->timestamp);
+            data->interface->set_interrupt(q->queue.head->timestamp);
         }
     } else {
-        // find the object before me, then drop me
-        ticker_event_t* p = data->queue->head;
-        while (p != NULL) {
-            if (p->next == obj) {
-                p->next = obj->next;
+        // find the object before me, starting from the last lane before my
+        // timestamp. The list is sorted, so once we're past my timestamp
+        // I'm not in the queue.
+        ticker_event_t *p = lane_start(q, lane_search(q, obj->timestamp, 1));
+        if (p == NULL) {
+            p = q->queue.head;
+        }
+        while (p != NULL && p->next != obj) {
+            if (p->next != NULL && (int)(p->next->timestamp - obj->timestamp) > 0) {
+                p = NULL;
                 break;
             }
             p = p->next;
         }
+        if (p != NULL) {
+            queue_unlink(q, p, obj);
+        } else if (q->flags & TICKER_QUEUE_FLAG_DISPATCHING) {
+            // it may be due in the batch being run, or inserted since
+            if (!list_remove(&q->expired, obj)) {
+                list_remove(&q->pending, obj);
+            }
+        }
     }
 
     core_util_critical_section_exit();
 }
 
+void ticker_set_low_power(const ticker_data_t *const data, const ticker_data_t *lp_data) {
+    get_queue(data)->low_power = lp_data;
+}
+
+const ticker_data_t *ticker_get_low_power(const ticker_data_t *const data) {
+    return get_queue(data)->low_power;
+}
+
 timestamp_t ticker_read(const ticker_data_t *const data)
 {
     return data->interface->read();
 }
+
+us_timestamp_t ticker_read_us64(const ticker_data_t *const data)
+{
+    ticker_queue_t *q = get_queue(data);
+    us_timestamp_t now;
+
+    if (!(q->flags & TICKER_QUEUE_FLAG_KEEPALIVE)) {
+        // The ticker may not have been used by a TimerEvent yet
+        data->interface->init();
+    }
+    core_util_critical_section_enter();
+    keepalive_start(data, q);
+    now = update_time(q, data->interface->read());
+    core_util_critical_section_exit();
+    return now;
+}
+
+void ticker_get_stats(const ticker_data_t *const data, ticker_stats_t *stats)
+{
+    core_util_critical_section_enter();
+    *stats = get_queue(data)->stats;
+    core_util_critical_section_exit();
+}
+
+void ticker_get_histograms(const ticker_data_t *const data, ticker_histogram_t *latency,
+                           ticker_histogram_t *handler_time)
+{
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+    const ticker_queue_t *q = get_queue(data);
+
+    core_util_critical_section_enter();
+    *latency = q->latency;
+    *handler_time = q->handler_time;
+    core_util_critical_section_exit();
+#else
+    (void)data;
+    memset(latency, 0, sizeof(*latency));
+    memset(handler_time, 0, sizeof(*handler_time));
+#endif
+}
+
+void ticker_reset_histograms(const ticker_data_t *const data)
+{
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+    ticker_queue_t *q = get_queue(data);
+
+    core_util_critical_section_enter();
+    memset(&q->latency, 0, sizeof(q->latency));
+    memset(&q->handler_time, 0, sizeof(q->handler_time));
+    core_util_critical_section_exit();
+#else
+    (void)data;
+#endif
+}
+
+void ticker_record_handler_time(const ticker_data_t *const data, timestamp_t ticks)
+{
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+    core_util_critical_section_enter();
+    histogram_add(&get_queue(data)->handler_time, ticks);
+    core_util_critical_section_exit();
+#else
+    (void)data; (void)ticks;
+#endif
+}
+
+uint32_t ticker_get_queue_length(const ticker_data_t *const data)
+{
+    return get_queue(data)->length;
+}
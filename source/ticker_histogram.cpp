@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/ticker_api_ext.h"
+
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+
+#include <stdio.h>
+
+#ifdef YOTTA_GREENTEA_CLIENT_VERSION_STRING
+#include "greentea-client/test_env.h"
+#else
+#include "mbed-drivers/test_env.h"
+#endif
+
+static void dump_histogram(const char *name, const char *kind, const ticker_histogram_t &histogram) {
+    char key[48];
+
+    for (unsigned i = 0; i < TICKER_HISTOGRAM_BUCKETS; i++) {
+        unsigned long start = (i == 0) ? 0 : 1ul << (i - 1);
+        snprintf(key, sizeof(key), "%s_%s_%lu", name, kind, start);
+#ifdef YOTTA_GREENTEA_CLIENT_VERSION_STRING
+        greentea_send_kv(key, (int)histogram.buckets[i]);
+#else
+        notify_performance_coefficient(key, (unsigned int)histogram.buckets[i]);
+#endif
+    }
+}
+#endif
+
+void ticker_dump_histograms(const ticker_data_t *const data, const char *name) {
+#if YOTTA_CFG_MBED_DRIVERS_TICKER_HISTOGRAMS
+    ticker_histogram_t latency, handler_time;
+
+    ticker_get_histograms(data, &latency, &handler_time);
+    dump_histogram(name, "latency", latency);
+    dump_histogram(name, "handler", handler_time);
+#else
+    (void)data;
+    (void)name;
+#endif
+}
@@ -15,8 +15,9 @@
  * limitations under the License.
  */
 #include "us_ticker_api.h"
+#include "mbed-drivers/ticker_api_ext.h"
 
-static ticker_event_queue_t events;
+static ticker_queue_t events;
 
 static const ticker_interface_t us_interface = {
     .init = us_ticker_init,
@@ -28,7 +29,7 @@ static const ticker_interface_t us_interface = {
 
 static const ticker_data_t us_data = {
     .interface = &us_interface,
-    .queue = &events,
+    .queue = &events.queue,
 };
 
 const ticker_data_t* get_us_ticker_data(void)
@@ -84,9 +84,12 @@ void I2CResourceManager::process_event(uint32_t event)
         if ((event & I2C_EVENT_ALL & ~I2C_EVENT_TRANSFER_COMPLETE) ||
                 ((event & I2C_EVENT_TRANSFER_COMPLETE) && TransactionDone)) {
             // fire the handler
-            minar::Scheduler::postCallback(
-                I2C_event_callback_t(this, &I2CResourceManager::handle_event).bind(t,event)
-            );
+            Completion completion = {this, t, event};
+            if (!_completions.post(completion)) {
+                minar::Scheduler::postCallback(
+                    I2C_event_callback_t(this, &I2CResourceManager::handle_event).bind(t,event)
+                );
+            }
             // Advance to the next transaction
             _TransactionQueue = t->get_next();
             if (_TransactionQueue) {
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/virtual_ticker.h"
+#include "mbed-drivers/ticker_api_ext.h"
+
+#include <stddef.h>
+
+/* A simulated one-shot interrupt, like the us ticker's */
+typedef struct {
+    ticker_queue_t events;
+    timestamp_t deadline;
+    int armed;
+} virtual_timer_t;
+
+static virtual_timer_t us;
+static virtual_timer_t lp;
+static timestamp_t now;
+static timestamp_t lp_now;
+static int32_t lp_drift_ppm;
+/* Drift of the low power ticker not counted in lp_now yet, in millionths of
+ * a tick */
+static int32_t lp_error;
+
+static void virtual_init(void) {
+}
+
+static uint32_t virtual_read(void) {
+    return now;
+}
+
+static void virtual_disable_interrupt(void) {
+    us.armed = 0;
+}
+
+static void virtual_clear_interrupt(void) {
+}
+
+static void virtual_set_interrupt(timestamp_t timestamp) {
+    us.deadline = timestamp;
+    us.armed = 1;
+}
+
+static uint32_t virtual_lp_read(void) {
+    return lp_now;
+}
+
+static void virtual_lp_disable_interrupt(void) {
+    lp.armed = 0;
+}
+
+static void virtual_lp_set_interrupt(timestamp_t timestamp) {
+    lp.deadline = timestamp;
+    lp.armed = 1;
+}
+
+static const ticker_interface_t virtual_interface = {
+    .init = virtual_init,
+    .read = virtual_read,
+    .disable_interrupt = virtual_disable_interrupt,
+    .clear_interrupt = virtual_clear_interrupt,
+    .set_interrupt = virtual_set_interrupt,
+};
+
+static const ticker_data_t virtual_data = {
+    .interface = &virtual_interface,
+    .queue = &us.events.queue,
+};
+
+static const ticker_interface_t virtual_lp_interface = {
+    .init = virtual_init,
+    .read = virtual_lp_read,
+    .disable_interrupt = virtual_lp_disable_interrupt,
+    .clear_interrupt = virtual_clear_interrupt,
+    .set_interrupt = virtual_lp_set_interrupt,
+};
+
+static const ticker_data_t virtual_lp_data = {
+    .interface = &virtual_lp_interface,
+    .queue = &lp.events.queue,
+};
+
+const ticker_data_t *get_virtual_ticker_data(void)
+{
+    return &virtual_data;
+}
+
+const ticker_data_t *get_virtual_lp_ticker_data(void)
+{
+    return &virtual_lp_data;
+}
+
+timestamp_t virtual_ticker_read(void)
+{
+    return now;
+}
+
+timestamp_t virtual_lp_ticker_read(void)
+{
+    return lp_now;
+}
+
+void virtual_lp_ticker_set_drift(int32_t ppm)
+{
+    lp_drift_ppm = ppm;
+}
+
+/* How far the low power ticker moves in ticks of the virtual ticker */
+static timestamp_t lp_ticks(timestamp_t ticks)
+{
+    int64_t error = lp_error + (int64_t)ticks * lp_drift_ppm;
+    return ticks + (timestamp_t)(int32_t)(error / 1000000);
+}
+
+static void move_time(timestamp_t ticks)
+{
+    int64_t error = lp_error + (int64_t)ticks * lp_drift_ppm;
+    lp_now += ticks + (timestamp_t)(int32_t)(error / 1000000);
+    lp_error = (int32_t)(error % 1000000);
+    now += ticks;
+}
+
+/* Ticks of the virtual ticker until the low power ticker reaches timestamp */
+static timestamp_t lp_delay(timestamp_t timestamp)
+{
+    int remaining = (int)(timestamp - lp_now);
+    timestamp_t ticks;
+
+    if (remaining <= 0) {
+        return 0;
+    }
+    ticks = (timestamp_t)(((int64_t)remaining * 1000000 - lp_error) / (1000000 + lp_drift_ppm));
+    while (ticks > 0 && lp_ticks(ticks - 1) >= (timestamp_t)remaining) {
+        ticks--;
+    }
+    while (lp_ticks(ticks) < (timestamp_t)remaining) {
+        ticks++;
+    }
+    return ticks;
+}
+
+/* Find the next interrupt of either ticker, the virtual ticker's first if
+ * both are due at the same time. Returns NULL if none is set. */
+static virtual_timer_t *next_interrupt(timestamp_t *delay)
+{
+    virtual_timer_t *next = NULL;
+
+    if (us.armed) {
+        // a deadline in the past fires at once
+        int remaining = (int)(us.deadline - now);
+        *delay = remaining > 0 ? (timestamp_t)remaining : 0;
+        next = &us;
+    }
+    if (lp.armed) {
+        timestamp_t lp_remaining = lp_delay(lp.deadline);
+        if (next == NULL || lp_remaining < *delay) {
+            *delay = lp_remaining;
+            next = &lp;
+        }
+    }
+    return next;
+}
+
+/* Fire the interrupt, which is one-shot */
+static void fire(virtual_timer_t *timer, timestamp_t delay)
+{
+    move_time(delay);
+    timer->armed = 0;
+    ticker_irq_handler(timer == &us ? &virtual_data : &virtual_lp_data);
+}
+
+uint32_t virtual_ticker_advance(timestamp_t ticks)
+{
+    timestamp_t target = now + ticks;
+    timestamp_t delay;
+    virtual_timer_t *next;
+    uint32_t irqs = 0;
+
+    while ((next = next_interrupt(&delay)) != NULL && (int)(now + delay - target) <= 0) {
+        fire(next, delay);
+        irqs++;
+    }
+    // a handler may have delayed the time past target
+    if ((int)(target - now) > 0) {
+        move_time(target - now);
+    }
+    return irqs;
+}
+
+void virtual_ticker_delay(timestamp_t ticks)
+{
+    move_time(ticks);
+}
+
+int virtual_ticker_run_next(void)
+{
+    timestamp_t delay;
+    virtual_timer_t *next = next_interrupt(&delay);
+
+    if (next == NULL) {
+        return 0;
+    }
+    fire(next, delay);
+    return 1;
+}
+
+int virtual_ticker_get_deadline(timestamp_t *deadline_out)
+{
+    if (us.armed) {
+        *deadline_out = us.deadline;
+    }
+    return us.armed;
+}
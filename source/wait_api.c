@@ -15,7 +15,41 @@
  * limitations under the License.
  */
 #include "mbed-drivers/wait_api.h"
+#include "mbed-drivers/ticker_api_ext.h"
 #include "us_ticker_api.h"
+#include "sleep_api.h"
+#include "cmsis.h"
+#include "core-util/critical.h"
+
+/* Waits used to measure how late the CPU wakes up */
+#define WAIT_CALIBRATION_ROUNDS     8
+#define WAIT_CALIBRATION_US         1000
+
+static uint32_t spin_threshold_us = YOTTA_CFG_MBED_DRIVERS_WAIT_SPIN_THRESHOLD_US;
+
+static int can_sleep(void) {
+    return __get_IPSR() == 0 && core_util_are_interrupts_enabled();
+}
+
+/* Sleep until delay microseconds after start, or a bit later */
+static void sleep_until(uint32_t start, uint32_t delay) {
+    const ticker_data_t *data = get_us_ticker_data();
+
+    ticker_insert_wakeup(data, start + delay);
+
+    /* The time is checked with interrupts disabled, so that the wake up
+     * interrupt can't slip in between the check and sleep(). A pending
+     * interrupt still wakes the CPU up, and runs once they're enabled. */
+    core_util_critical_section_enter();
+    while ((us_ticker_read() - start) < delay) {
+        sleep();
+        core_util_critical_section_exit();
+        core_util_critical_section_enter();
+    }
+    core_util_critical_section_exit();
+
+    ticker_remove_wakeup(data);
+}
 
 void wait(float s) {
     wait_us(s * 1000000.0f);
@@ -27,5 +61,37 @@ void wait_ms(int ms) {
 
 void wait_us(int us) {
     uint32_t start = us_ticker_read();
+    uint32_t spin = spin_threshold_us;
+
+    if ((uint32_t)us > spin && can_sleep()) {
+        sleep_until(start, (uint32_t)us - spin);
+    }
     while ((us_ticker_read() - start) < (uint32_t)us);
 }
+
+void wait_set_spin_threshold_us(uint32_t us) {
+    spin_threshold_us = us;
+}
+
+uint32_t wait_get_spin_threshold_us(void) {
+    return spin_threshold_us;
+}
+
+uint32_t wait_calibrate(void) {
+    uint32_t worst = 0;
+
+    if (!can_sleep()) {
+        return spin_threshold_us;
+    }
+    for (int i = 0; i < WAIT_CALIBRATION_ROUNDS; i++) {
+        uint32_t start = us_ticker_read();
+        sleep_until(start, WAIT_CALIBRATION_US);
+        uint32_t late = us_ticker_read() - start - WAIT_CALIBRATION_US;
+        if (late > worst) {
+            worst = late;
+        }
+    }
+    /* Leave as much margin again for the wake ups slower than the ones seen */
+    spin_threshold_us = 2 * worst;
+    return spin_threshold_us;
+}
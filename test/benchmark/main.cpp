@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include "mbed-drivers/mbed.h"
+#include "mbed-drivers/ticker_api_ext.h"
+#include "mbed-drivers/virtual_ticker.h"
+#include "mbed-drivers/InlineCallChain.h"
+#include "mbed-drivers/CompletionQueue.h"
+#include "cmsis.h"
+#if defined(NVIC_NUM_VECTORS)
+#include "mbed-drivers/InterruptManager.h"
+#endif
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+using namespace utest::v1;
+
+// Every allocation made by the code under test goes through these
+namespace {
+volatile uint32_t allocation_count;
+volatile uint32_t allocation_bytes;
+}
+
+void *operator new(std::size_t size) {
+    allocation_count++;
+    allocation_bytes += size;
+    return malloc(size);
+}
+
+void *operator new[](std::size_t size) {
+    allocation_count++;
+    allocation_bytes += size;
+    return malloc(size);
+}
+
+void operator delete(void *p) {
+    free(p);
+}
+
+void operator delete[](void *p) {
+    free(p);
+}
+
+namespace {
+const int MAX_EVENTS = 1000;
+const int ROUNDS = 10;
+
+ticker_event_t events[MAX_EVENTS];
+ticker_queue_t bench_queue;
+
+// The queue never fires, it only needs a ticker interface
+void null_init(void) {}
+uint32_t null_read(void) { return 0; }
+void null_interrupt(void) {}
+void null_set_interrupt(timestamp_t) {}
+
+const ticker_interface_t null_interface = {
+    null_init, null_read, null_interrupt, null_interrupt, null_set_interrupt
+};
+const ticker_data_t bench_data = { &null_interface, &bench_queue.queue };
+
+volatile uint32_t calls;
+
+void count_call() {
+    calls++;
+}
+
+void count_event(uint32_t) {
+    calls++;
+}
+
+// Times and counts the allocations of operations, between start() and
+// stop() calls, and sends the results to the host as
+// "bench_<name>_<size>_ns_per_op", "bench_<name>_<size>_counts_per_op" (in
+// CycleTimer counts, CPU cycles on Cortex-M3/M4/M7) and
+// "bench_<name>_<size>_milliallocs_per_op"
+class Measure {
+public:
+    Measure(const char *name, int size) : _name(name), _size(size), _start(0), _allocations(0), _ops(0) {
+    }
+
+    void start() {
+        _start = allocation_count;
+        _timer.start();
+    }
+
+    void stop(uint32_t ops) {
+        _timer.stop();
+        _allocations += allocation_count - _start;
+        _ops += ops;
+    }
+
+    void report() {
+        char key[64];
+
+        snprintf(key, sizeof(key), "bench_%s_%d_ns_per_op", _name, _size);
+        greentea_send_kv(key, (int)(_timer.read_ns() / _ops));
+        snprintf(key, sizeof(key), "bench_%s_%d_counts_per_op", _name, _size);
+        greentea_send_kv(key, (int)(_timer.read_counts() / _ops));
+        snprintf(key, sizeof(key), "bench_%s_%d_milliallocs_per_op", _name, _size);
+        greentea_send_kv(key, (int)((uint64_t)_allocations * 1000 / _ops));
+    }
+
+    uint32_t allocations() const {
+        return _allocations;
+    }
+
+private:
+    const char *_name;
+    int _size;
+    CycleTimer _timer;
+    uint32_t _start;
+    uint32_t _allocations;
+    uint32_t _ops;
+};
+}
+
+// xorshift32, so that every run sees the same sequence of timestamps
+uint32_t next_random(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+template <int N>
+void test_case_ticker_insert() {
+    uint32_t seed = 0x2545F491;
+    Measure insert("ticker_insert_event", N);
+    Measure remove("ticker_remove_event", N);
+
+    for (int r = 0; r < ROUNDS; r++) {
+        insert.start();
+        for (int i = 0; i < N; i++) {
+            ticker_insert_event(&bench_data, &events[i], next_random(seed) % 1000000, i + 1);
+        }
+        insert.stop(N);
+        remove.start();
+        for (int i = 0; i < N; i++) {
+            // 7 is coprime with all the sizes used, so every event is removed
+            ticker_remove_event(&bench_data, &events[(i * 7) % N]);
+        }
+        remove.stop(N);
+        TEST_ASSERT_NULL(bench_data.queue->head);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, insert.allocations());
+    TEST_ASSERT_EQUAL_UINT32(0, remove.allocations());
+    insert.report();
+    remove.report();
+}
+
+template <int N>
+void test_case_ticker_dispatch() {
+    const ticker_data_t *data = get_virtual_ticker_data();
+    Measure dispatch("ticker_dispatch", N);
+
+    ticker_set_handler(data, count_event);
+    calls = 0;
+    dispatch.start();
+    for (int r = 0; r < ROUNDS; r++) {
+        timestamp_t now = virtual_ticker_read();
+        for (int i = 0; i < N; i++) {
+            ticker_insert_event(data, &events[i], now + 1 + i, i + 1);
+        }
+        virtual_ticker_advance(N);
+    }
+    dispatch.stop(ROUNDS * N);
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS * N, calls);
+    dispatch.report();
+}
+
+template <typename Chain, int N>
+void measure_callchain(Chain &chain, const char *add_name, const char *call_name, bool heap_free) {
+    const int OPS = 1000;
+    pFunctionPointer_t added[N];
+
+    Measure add(add_name, N);
+    add.start();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < N; i++) {
+            added[i] = chain.add(count_call);
+        }
+        for (int i = 0; i < N; i++) {
+            chain.remove(added[i]);
+        }
+    }
+    add.stop(ROUNDS * N);
+    TEST_ASSERT_EQUAL_INT(0, chain.size());
+    if (heap_free) {
+        TEST_ASSERT_EQUAL_UINT32(0, add.allocations());
+    }
+    add.report();
+
+    for (int i = 0; i < N; i++) {
+        chain.add(count_call);
+    }
+    calls = 0;
+    Measure call(call_name, N);
+    call.start();
+    for (int i = 0; i < OPS; i++) {
+        chain.call();
+    }
+    call.stop(OPS);
+    TEST_ASSERT_EQUAL_UINT32(OPS * N, calls);
+    TEST_ASSERT_EQUAL_UINT32(0, call.allocations());
+    call.report();
+}
+
+template <int N>
+void test_case_callchain() {
+    CallChain chain;
+    measure_callchain<CallChain, N>(chain, "CallChain_add_remove", "CallChain_call", false);
+}
+
+template <int N>
+void test_case_static_callchain() {
+    StaticCallChain<N> chain;
+    measure_callchain<InlineCallChain, N>(chain, "StaticCallChain_add_remove", "StaticCallChain_call", true);
+}
+
+#if defined(NVIC_NUM_VECTORS)
+// The original dispatch of InterruptManager: a singleton lookup in a table
+// of every vector, then a CallChain of heap allocated function objects
+class LegacyDispatch {
+public:
+    static LegacyDispatch *get() {
+        if (NULL == _instance)
+            _instance = new LegacyDispatch();
+        return _instance;
+    }
+
+    void irq_helper(int index) {
+        _chains[index]->call();
+    }
+
+    CallChain *_chains[NVIC_NUM_VECTORS];
+
+private:
+    LegacyDispatch() {
+        memset(_chains, 0, sizeof(_chains));
+    }
+
+    static LegacyDispatch *_instance;
+};
+
+LegacyDispatch *LegacyDispatch::_instance;
+
+// Both paths are called for an interrupt which stays disabled, from thread
+// mode: the exception number comes from a variable instead of IPSR
+template <int N>
+void test_case_interrupt_dispatch() {
+    const int OPS = 1000;
+    const IRQn_Type irq = (IRQn_Type)(NVIC_NUM_VECTORS - NVIC_USER_IRQ_OFFSET - 1);
+    volatile int index = (int)irq + NVIC_USER_IRQ_OFFSET;
+    pFunctionPointer_t handlers[N];
+
+    NVIC_DisableIRQ(irq);
+    uint32_t vector = NVIC_GetVector(irq);
+    NVIC_SetVector(irq, (uint32_t)count_call);
+
+    LegacyDispatch *legacy = LegacyDispatch::get();
+    legacy->_chains[index] = new CallChain(4);
+    legacy->_chains[index]->add(count_call);
+    for (int i = 0; i < N; i++) {
+        legacy->_chains[index]->add(count_call);
+        handlers[i] = InterruptManager::get()->add_handler(count_call, irq);
+        TEST_ASSERT_NOT_NULL(handlers[i]);
+    }
+
+    calls = 0;
+    Measure legacy_dispatch("interrupt_dispatch_legacy", N);
+    legacy_dispatch.start();
+    for (int i = 0; i < OPS; i++) {
+        LegacyDispatch::get()->irq_helper(index);
+    }
+    legacy_dispatch.stop(OPS);
+    TEST_ASSERT_EQUAL_UINT32(OPS * (N + 1), calls);
+    legacy_dispatch.report();
+
+    calls = 0;
+    Measure sparse_dispatch("interrupt_dispatch_sparse", N);
+    sparse_dispatch.start();
+    for (int i = 0; i < OPS; i++) {
+        InterruptManager::call_handlers(irq);
+    }
+    sparse_dispatch.stop(OPS);
+    TEST_ASSERT_EQUAL_UINT32(OPS * (N + 1), calls);
+    sparse_dispatch.report();
+
+    for (int i = 0; i < N; i++) {
+        TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(handlers[i], irq));
+    }
+    delete legacy->_chains[index];
+    legacy->_chains[index] = NULL;
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)count_call, NVIC_GetVector(irq));
+    NVIC_SetVector(irq, vector);
+}
+
+// RAM used to chain one handler on each of N interrupts, in bytes, with the
+// sparse index of InterruptManager and with the legacy table, sent as
+// "footprint_interrupt_sparse_<N>_bytes" and
+// "footprint_interrupt_legacy_<N>_bytes" with the configuration they are for.
+// Heap bytes are the sizes requested from operator new.
+template <int N>
+void test_case_interrupt_footprint() {
+    const int n = N < YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS ? N : YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS;
+    const IRQn_Type last = (IRQn_Type)(NVIC_NUM_VECTORS - NVIC_USER_IRQ_OFFSET - 1);
+    pFunctionPointer_t handlers[N];
+    char key[64];
+
+    // count the instance too, unless other code chains interrupts already
+    if (InterruptManager::shared_vectors() == 0)
+        InterruptManager::destroy();
+    uint32_t sparse_bytes = allocation_bytes;
+    for (int i = 0; i < n; i++) {
+        handlers[i] = InterruptManager::get()->add_handler(count_call, (IRQn_Type)(last - i));
+        TEST_ASSERT_NOT_NULL(handlers[i]);
+    }
+    sparse_bytes = allocation_bytes - sparse_bytes;
+    sparse_bytes += YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS * (sizeof(uint16_t) + sizeof(InlineCallChain *));
+    sparse_bytes += sizeof(int) + sizeof(InterruptManager *);
+    for (int i = 0; i < n; i++) {
+        TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(handlers[i], (IRQn_Type)(last - i)));
+    }
+
+    CallChain *chains[N];
+    uint32_t legacy_bytes = allocation_bytes;
+    for (int i = 0; i < n; i++) {
+        chains[i] = new CallChain(4);
+        chains[i]->add((void (*)(void))NVIC_GetVector((IRQn_Type)(last - i)));
+        chains[i]->add(count_call);
+    }
+    legacy_bytes = allocation_bytes - legacy_bytes;
+    legacy_bytes += sizeof(LegacyDispatch) + sizeof(LegacyDispatch *);
+    for (int i = 0; i < n; i++) {
+        delete chains[i];
+    }
+
+    greentea_send_kv("footprint_interrupt_shared_vectors", YOTTA_CFG_MBED_DRIVERS_INTERRUPT_SHARED_VECTORS);
+    greentea_send_kv("footprint_interrupt_handlers", YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS);
+    snprintf(key, sizeof(key), "footprint_interrupt_sparse_%d_bytes", n);
+    greentea_send_kv(key, (int)sparse_bytes);
+    snprintf(key, sizeof(key), "footprint_interrupt_legacy_%d_bytes", n);
+    greentea_send_kv(key, (int)legacy_bytes);
+}
+#endif
+
+template <int N>
+void test_case_circularbuffer() {
+    const int ROUNDS = 10000 / N;
+    CircularBuffer<uint32_t, N> buffer;
+    uint32_t sum = 0, value;
+
+    Measure push_pop("CircularBuffer_push_pop", N);
+    push_pop.start();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int j = 0; j < N; j++) {
+            buffer.push(j);
+        }
+        TEST_ASSERT_TRUE(buffer.full());
+        while (buffer.pop(value)) {
+            sum += value;
+        }
+    }
+    push_pop.stop(ROUNDS * N);
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS * (N * (N - 1) / 2), sum);
+    TEST_ASSERT_EQUAL_UINT32(0, push_pop.allocations());
+    push_pop.report();
+}
+
+namespace {
+struct CountedCompletion {
+    void complete() {
+        calls++;
+    }
+};
+
+// Runs the completion task from the test, rather than from minar
+template <uint32_t N>
+class BenchCompletionQueue : public CompletionQueue<CountedCompletion, N> {
+public:
+    static void drain() {
+        CompletionSource::run();
+    }
+};
+}
+
+// Bursts of N completions posted then run, as a driver interrupt handler
+// and the completion task would. The scheduler posts per completion are
+// reported as "bench_CompletionQueue_<N>_milliwakeups_per_op".
+template <int N>
+void test_case_completion_queue() {
+    const int ROUNDS = 1000 / N;
+    BenchCompletionQueue<N> queue;
+    CountedCompletion completion;
+    char key[64];
+
+    calls = 0;
+    uint32_t wakeups = CompletionSource::wakeups();
+    Measure post_run("CompletionQueue", N);
+    for (int r = 0; r < ROUNDS; r++) {
+        post_run.start();
+        for (int j = 0; j < N; j++) {
+            TEST_ASSERT_TRUE(queue.post(completion));
+        }
+        BenchCompletionQueue<N>::drain();
+        post_run.stop(N);
+    }
+    wakeups = CompletionSource::wakeups() - wakeups;
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS * N, calls);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.overflows());
+    // one post of the completion task per burst
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS, wakeups);
+    post_run.report();
+    snprintf(key, sizeof(key), "bench_CompletionQueue_%d_milliwakeups_per_op", N);
+    greentea_send_kv(key, (int)((uint64_t)wakeups * 1000 / (ROUNDS * N)));
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("Benchmark: ticker insert/remove, 10 events", test_case_ticker_insert<10>, greentea_failure_handler),
+    Case("Benchmark: ticker insert/remove, 100 events", test_case_ticker_insert<100>, greentea_failure_handler),
+    Case("Benchmark: ticker insert/remove, 1000 events", test_case_ticker_insert<1000>, greentea_failure_handler),
+    Case("Benchmark: ticker dispatch, 10 events", test_case_ticker_dispatch<10>, greentea_failure_handler),
+    Case("Benchmark: ticker dispatch, 1000 events", test_case_ticker_dispatch<1000>, greentea_failure_handler),
+    Case("Benchmark: CallChain, 1 function", test_case_callchain<1>, greentea_failure_handler),
+    Case("Benchmark: CallChain, 4 functions", test_case_callchain<4>, greentea_failure_handler),
+    Case("Benchmark: CallChain, 16 functions", test_case_callchain<16>, greentea_failure_handler),
+    Case("Benchmark: StaticCallChain, 1 function", test_case_static_callchain<1>, greentea_failure_handler),
+    Case("Benchmark: StaticCallChain, 4 functions", test_case_static_callchain<4>, greentea_failure_handler),
+    Case("Benchmark: StaticCallChain, 16 functions", test_case_static_callchain<16>, greentea_failure_handler),
+#if defined(NVIC_NUM_VECTORS)
+    Case("Benchmark: interrupt dispatch, 1 handler", test_case_interrupt_dispatch<1>, greentea_failure_handler),
+    Case("Benchmark: interrupt dispatch, 4 handlers", test_case_interrupt_dispatch<4>, greentea_failure_handler),
+    Case("Footprint: InterruptManager, 1 interrupt", test_case_interrupt_footprint<1>, greentea_failure_handler),
+    Case("Footprint: InterruptManager, 8 interrupts", test_case_interrupt_footprint<8>, greentea_failure_handler),
+#endif
+    Case("Benchmark: CircularBuffer, 4 entries", test_case_circularbuffer<4>, greentea_failure_handler),
+    Case("Benchmark: CircularBuffer, 64 entries", test_case_circularbuffer<64>, greentea_failure_handler),
+    Case("Benchmark: CompletionQueue, 1 completion", test_case_completion_queue<1>, greentea_failure_handler),
+    Case("Benchmark: CompletionQueue, 8 completions", test_case_completion_queue<8>, greentea_failure_handler),
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include "mbed-drivers/mbed.h"
+#include "mbed-drivers/InlineCallChain.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#if defined(TARGET_LIKE_POSIX)
+#include <pthread.h>
+#endif
+
+using namespace utest::v1;
+
+namespace {
+const int CAPACITY = 16;
+const int PROBES = 8;
+const int PASSES = 200000;
+const uint32_t MIN_STEPS = 10000;
+const uint32_t MAGIC = 0x5AFEC0DE;
+
+volatile uint32_t bad_calls;
+volatile uint32_t calls_in_pass;
+volatile uint32_t current_pass;
+
+// A function of the chain, which checks that it is called on a live object,
+// and not by a call() which started after it was removed. A call() which was
+// running when the probe was removed may still reach its old slot, and its
+// new one if it was added again meanwhile.
+class Probe {
+public:
+    Probe() : _magic(MAGIC), _calls(0), _linked(false), _removed_in(0) {
+    }
+
+    void on_call() {
+        if (_magic != MAGIC || (!_linked && _removed_in < current_pass)) {
+            bad_calls++;
+        }
+        _calls++;
+        calls_in_pass++;
+    }
+
+    // Called before the probe is added
+    void link() {
+        _linked = true;
+    }
+
+    // Called after the probe was removed, or failed to be added: the passes
+    // after the one read here start after the removal
+    void unlink() {
+        _removed_in = current_pass;
+        _linked = false;
+    }
+
+    uint32_t calls() const {
+        return _calls;
+    }
+
+    void reset() {
+        _calls = 0;
+    }
+
+private:
+    uint32_t _magic;
+    volatile uint32_t _calls;
+    volatile bool _linked;
+    volatile uint32_t _removed_in;
+};
+
+StaticCallChain<CAPACITY> chain;
+
+// Adds and removes its own probes at random
+class Writer {
+public:
+    Writer() : _state(0), _steps(0), _full(0), _lost(0) {
+        for (int i = 0; i < PROBES; i++) {
+            _handles[i] = NULL;
+        }
+    }
+
+    void seed(uint32_t state) {
+        _state = state;
+    }
+
+    void step() {
+        // xorshift32
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        int i = _state % PROBES;
+        if (_handles[i] == NULL) {
+            _probes[i].link();
+            if (_state & 0x100) {
+                _handles[i] = chain.add(&_probes[i], &Probe::on_call);
+            } else {
+                _handles[i] = chain.add_front(&_probes[i], &Probe::on_call);
+            }
+            if (_handles[i] == NULL) {
+                _probes[i].unlink();
+                _full++;
+            }
+        } else {
+            if (!chain.remove(_handles[i])) {
+                _lost++;
+            }
+            _probes[i].unlink();
+            _handles[i] = NULL;
+        }
+        _steps++;
+    }
+
+    void reset() {
+        for (int i = 0; i < PROBES; i++) {
+            _probes[i].reset();
+        }
+    }
+
+    // Check that exactly the probes in the chain were called once
+    void check_called() {
+        for (int i = 0; i < PROBES; i++) {
+            TEST_ASSERT_EQUAL_UINT32(_handles[i] != NULL ? 1 : 0, _probes[i].calls());
+        }
+        TEST_ASSERT_EQUAL_UINT32(0, _lost);
+    }
+
+    int live() const {
+        int n = 0;
+        for (int i = 0; i < PROBES; i++) {
+            n += _handles[i] != NULL;
+        }
+        return n;
+    }
+
+    uint32_t steps() const {
+        return _steps;
+    }
+
+private:
+    uint32_t _state;
+    volatile uint32_t _steps;
+    uint32_t _full;
+    uint32_t _lost;
+    Probe _probes[PROBES];
+    pFunctionPointer_t _handles[PROBES];
+};
+
+Writer writers[2];
+
+StaticCallChainArena<2> shared_arena;
+InlineCallChain *self_chain;
+pFunctionPointer_t self_handle;
+
+void remove_self() {
+    self_chain->remove(self_handle);
+}
+
+void nothing() {
+}
+
+#if defined(TARGET_LIKE_POSIX)
+volatile bool stop;
+
+void *writer_thread(void *arg) {
+    Writer *writer = static_cast<Writer *>(arg);
+    while (!stop) {
+        writer->step();
+    }
+    return NULL;
+}
+#endif
+}
+
+// Call the chain while two writers change it: two threads on POSIX hosts,
+// an interrupt handler and the calling thread on targets
+void test_case_stress() {
+    uint32_t max_calls = 0;
+
+    writers[0].seed(0x2545F491);
+    writers[1].seed(0x9E3779B9);
+    bad_calls = 0;
+
+#if defined(TARGET_LIKE_POSIX)
+    pthread_t threads[2];
+    stop = false;
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, writer_thread, &writers[i]));
+    }
+#else
+    Ticker ticker;
+    ticker.attach_us(&writers[0], &Writer::step, 50);
+#endif
+
+    // until both writers ran for a while, which threads may not do at once
+    for (int pass = 0; pass < PASSES || writers[0].steps() < MIN_STEPS || writers[1].steps() < MIN_STEPS; pass++) {
+        calls_in_pass = 0;
+        current_pass = pass + 1;
+        chain.call();
+        // a call() sees each slot at most once
+        if (calls_in_pass > max_calls) {
+            max_calls = calls_in_pass;
+        }
+#if !defined(TARGET_LIKE_POSIX)
+        writers[1].step();
+#endif
+    }
+
+#if defined(TARGET_LIKE_POSIX)
+    stop = true;
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    ticker.detach();
+#endif
+
+    TEST_ASSERT_EQUAL_UINT32(0, bad_calls);
+    TEST_ASSERT_TRUE(max_calls <= CAPACITY);
+    TEST_ASSERT_EQUAL_INT(writers[0].live() + writers[1].live(), chain.size());
+
+    for (int i = 0; i < 2; i++) {
+        writers[i].reset();
+    }
+    current_pass++;
+    chain.call();
+    for (int i = 0; i < 2; i++) {
+        writers[i].check_called();
+    }
+    greentea_send_kv("writer_0_steps", writers[0].steps());
+    greentea_send_kv("writer_1_steps", writers[1].steps());
+}
+
+// A function removing itself retires its slot, which the arena gets back
+// when the call() returns, for any chain sharing it
+void test_case_self_removal() {
+    InlineCallChain first(shared_arena);
+    InlineCallChain second(shared_arena);
+    self_chain = &first;
+
+    TEST_ASSERT_NOT_NULL(second.add(nothing));
+    self_handle = first.add(remove_self);
+    TEST_ASSERT_NOT_NULL(self_handle);
+    TEST_ASSERT_EQUAL_INT(0, shared_arena.available());
+
+    first.call();
+    TEST_ASSERT_EQUAL_INT(0, first.size());
+    TEST_ASSERT_EQUAL_INT(0, first.retired());
+    TEST_ASSERT_EQUAL_INT(1, shared_arena.available());
+    TEST_ASSERT_NOT_NULL(second.add(nothing));
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("InlineCallChain: concurrent changes", test_case_stress, greentea_failure_handler),
+    Case("InlineCallChain: removal from a call", test_case_self_removal, greentea_failure_handler),
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/mbed.h"
+#include "mbed-drivers/CThunk.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+using namespace utest::v1;
+
+namespace {
+const int THUNKS = 8;
+
+// Counts the calls made through its thunk, and the context they got
+class Counter {
+public:
+    Counter() : calls(0), context(NULL), thunk(this, &Counter::on_call) {
+    }
+
+    void on_call(void *c) {
+        calls++;
+        context = c;
+    }
+
+    void on_simple_call() {
+        calls += 100;
+    }
+
+    int calls;
+    void *context;
+    CThunk<Counter> thunk;
+};
+}
+
+void test_case_call() {
+    Counter counter;
+    int value;
+
+    counter.thunk.call();
+    TEST_ASSERT_EQUAL_INT(1, counter.calls);
+    TEST_ASSERT_NULL(counter.context);
+
+    counter.thunk.context(&value);
+    CThunkEntry entry = counter.thunk;
+    entry();
+    TEST_ASSERT_EQUAL_INT(2, counter.calls);
+    TEST_ASSERT_EQUAL_PTR(&value, counter.context);
+
+    // the way drivers hand the thunk to the HAL
+    ((CThunkEntry)(uintptr_t)counter.thunk.entry())();
+    TEST_ASSERT_EQUAL_INT(3, counter.calls);
+
+    counter.thunk.callback(&Counter::on_simple_call);
+    counter.thunk.call();
+    TEST_ASSERT_EQUAL_INT(103, counter.calls);
+}
+
+void test_case_instances() {
+    Counter *counters[THUNKS];
+
+    for (int i = 0; i < THUNKS; i++) {
+        counters[i] = new Counter();
+    }
+    for (int i = 0; i < THUNKS; i++) {
+        for (int j = 0; j <= i; j++) {
+            counters[i]->thunk.call();
+        }
+    }
+    for (int i = 0; i < THUNKS; i++) {
+        TEST_ASSERT_EQUAL_INT(i + 1, counters[i]->calls);
+        delete counters[i];
+    }
+
+    // the entries of destroyed thunks are reused
+    for (int round = 0; round < 100; round++) {
+        Counter counter;
+        counter.thunk.call();
+        TEST_ASSERT_EQUAL_INT(1, counter.calls);
+    }
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("CThunk: call, entry and context", test_case_call, greentea_failure_handler),
+    Case("CThunk: several instances", test_case_instances, greentea_failure_handler),
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(20, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}
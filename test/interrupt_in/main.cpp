@@ -0,0 +1,446 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/mbed.h"
+#include "mbed-drivers/virtual_ticker.h"
+#include "mbed-drivers/CompletionQueue.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+using namespace utest::v1;
+
+namespace {
+const uint32_t CAPTURE_SIZE = 8;
+const int MAX_EDGES = 32;
+const int MAX_BATCHES = 8;
+
+// An InterruptIn timed by the virtual ticker, whose edges are simulated by
+// calling the interrupt handler. The pin is driven as an output, which
+// reads back the level written to it, with its own edge interrupts off.
+class SimulatedInput : public InterruptIn {
+public:
+    SimulatedInput(PinName pin) : InterruptIn(pin, get_virtual_ticker_data()) {
+        gpio_dir(&gpio, PIN_OUTPUT);
+        gpio_write(&gpio, 0);
+    }
+
+    // Turn off the edge interrupts of the pin again, after a mode change
+    void quiet() {
+        gpio_irq_set(&gpio_irq, IRQ_RISE, 0);
+        gpio_irq_set(&gpio_irq, IRQ_FALL, 0);
+    }
+
+    // Change the level without an interrupt, like a bounce while masked
+    void level(int value) {
+        gpio_write(&gpio, value);
+    }
+
+    void edge(int value) {
+        level(value);
+        _irq_handler((uint32_t)this, value ? IRQ_RISE : IRQ_FALL);
+    }
+
+    // Run the capture delivery task now
+    void deliver() {
+        deliver_edges();
+    }
+
+    // Send and deliver edges until the next one goes to the start of the
+    // capture buffer, so that the tests know where the edges wrap around
+    void rewind() {
+        while ((_capture_head & (_capture_size - 1)) != 0) {
+            edge(0);
+            deliver_edges();
+        }
+    }
+
+    void reset() {
+        capture_stop();
+        count_stop();
+        debounce(0);
+        rate_limit(0);
+        rise(NULL);
+        fall(NULL);
+        level(0);
+        quiet();
+    }
+};
+
+SimulatedInput input(LED1);
+FrequencyCounter frequency(input, 1000, 4);
+
+InterruptIn::Edge capture_buffer[CAPTURE_SIZE];
+InterruptIn::Edge other_buffer[CAPTURE_SIZE];
+InterruptIn::Edge captured[MAX_EDGES];
+int captured_count;
+uint32_t batches[MAX_BATCHES];
+int batch_count;
+const InterruptIn::Edge *last_batch;
+bool restart_in_handler;
+int rises;
+int falls;
+
+void on_edges(const InterruptIn::Edge *edges, uint32_t count) {
+    if (batch_count < MAX_BATCHES) {
+        batches[batch_count] = count;
+    }
+    batch_count++;
+    last_batch = edges;
+    for (uint32_t i = 0; i < count && captured_count < MAX_EDGES; i++) {
+        captured[captured_count++] = edges[i];
+    }
+    if (restart_in_handler) {
+        restart_in_handler = false;
+        input.capture(other_buffer, CAPTURE_SIZE, on_edges);
+    }
+}
+
+void start_capture(InterruptIn::Edge *buffer) {
+    input.reset();
+    TEST_ASSERT_TRUE(input.capture(buffer, CAPTURE_SIZE, on_edges));
+    input.quiet();
+    input.rewind();
+    captured_count = 0;
+    batch_count = 0;
+}
+
+void on_rise() {
+    rises++;
+}
+
+void on_fall() {
+    falls++;
+}
+
+// Alternate edges, 10us apart, starting with a rising one at time start
+void send_edges(int n, timestamp_t *start) {
+    *start = virtual_ticker_read();
+    for (int i = 0; i < n; i++) {
+        input.edge(i % 2 == 0);
+        virtual_ticker_advance(10);
+    }
+}
+
+// Runs the completion task from the test, rather than from minar
+class CompletionTask : public CompletionSource {
+public:
+    static void run() {
+        CompletionSource::run();
+    }
+};
+
+void check_captured(int first, int n, timestamp_t start) {
+    for (int i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_UINT32(start + 10 * i, captured[first + i].timestamp);
+        TEST_ASSERT_EQUAL_INT(i % 2 == 0, captured[first + i].rise);
+    }
+}
+}
+
+// Edges delivered in order, in two batches once they wrap around the buffer
+void test_case_capture_wrap() {
+    timestamp_t start;
+
+    TEST_ASSERT_FALSE(input.capture(capture_buffer, 6, on_edges));
+    start_capture(capture_buffer);
+
+    send_edges(6, &start);
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(1, batch_count);
+    TEST_ASSERT_EQUAL_UINT32(6, batches[0]);
+    check_captured(0, 6, start);
+
+    // 2 edges at the end of the buffer, 4 at the beginning
+    send_edges(6, &start);
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(3, batch_count);
+    TEST_ASSERT_EQUAL_UINT32(2, batches[1]);
+    TEST_ASSERT_EQUAL_UINT32(4, batches[2]);
+    check_captured(6, 6, start);
+    TEST_ASSERT_EQUAL_UINT32(0, input.capture_overflows());
+}
+
+// Edges which don't fit are dropped and counted, the oldest are kept
+void test_case_capture_overflow() {
+    timestamp_t start;
+
+    start_capture(capture_buffer);
+    uint32_t overflows = input.capture_overflows();
+
+    send_edges(CAPTURE_SIZE + 3, &start);
+    TEST_ASSERT_EQUAL_UINT32(overflows + 3, input.capture_overflows());
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(CAPTURE_SIZE, captured_count);
+    check_captured(0, CAPTURE_SIZE, start);
+
+    // the room is given back once delivered
+    send_edges(2, &start);
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(CAPTURE_SIZE + 2, captured_count);
+    check_captured(CAPTURE_SIZE, 2, start);
+    TEST_ASSERT_EQUAL_UINT32(overflows + 3, input.capture_overflows());
+}
+
+// A handler restarting capture drops the edges still waiting, and the next
+// edges go to the new buffer
+void test_case_capture_restart() {
+    timestamp_t start;
+
+    start_capture(capture_buffer);
+    send_edges(6, &start);
+    input.deliver();
+
+    // wrap, so the restart happens between the two batches
+    send_edges(6, &start);
+    restart_in_handler = true;
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(2, batch_count);
+    TEST_ASSERT_EQUAL_INT(8, captured_count);
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(2, batch_count);
+
+    send_edges(3, &start);
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(3, batch_count);
+    TEST_ASSERT_TRUE(last_batch >= other_buffer && last_batch < other_buffer + CAPTURE_SIZE);
+    check_captured(8, 3, start);
+
+    input.capture_stop();
+    send_edges(2, &start);
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(3, batch_count);
+}
+
+// The completion task delivers the edges, posted once per batch
+void test_case_capture_task() {
+    timestamp_t start;
+
+    start_capture(capture_buffer);
+    CompletionTask::run();
+    uint32_t wakeups = CompletionSource::wakeups();
+    send_edges(3, &start);
+    TEST_ASSERT_EQUAL_UINT32(wakeups + 1, CompletionSource::wakeups());
+    TEST_ASSERT_EQUAL_INT(0, captured_count);
+    CompletionTask::run();
+    TEST_ASSERT_EQUAL_INT(1, batch_count);
+    check_captured(0, 3, start);
+
+    // a new batch posts the task again, a stopped capture isn't delivered
+    input.edge(1);
+    TEST_ASSERT_EQUAL_UINT32(wakeups + 2, CompletionSource::wakeups());
+    input.capture_stop();
+    CompletionTask::run();
+    TEST_ASSERT_EQUAL_INT(1, batch_count);
+}
+
+// Only the selected edges are counted, without calling the functions
+void test_case_count() {
+    input.reset();
+    rises = 0;
+    falls = 0;
+    input.rise(on_rise);
+    input.fall(on_fall);
+    uint32_t count = input.edge_count();
+
+    input.count();
+    input.quiet();
+    for (int i = 0; i < 4; i++) {
+        input.edge(i % 2 == 0);
+    }
+    TEST_ASSERT_EQUAL_UINT32(count + 2, input.edge_count());
+    input.count(true, true);
+    input.quiet();
+    for (int i = 0; i < 4; i++) {
+        input.edge(i % 2 == 0);
+    }
+    TEST_ASSERT_EQUAL_UINT32(count + 6, input.edge_count());
+    input.count(false, true);
+    input.quiet();
+    input.edge(1);
+    input.edge(0);
+    TEST_ASSERT_EQUAL_UINT32(count + 7, input.edge_count());
+    TEST_ASSERT_EQUAL_INT(0, rises);
+    TEST_ASSERT_EQUAL_INT(0, falls);
+
+    // the counter keeps its value once stopped
+    input.count_stop();
+    input.quiet();
+    input.edge(1);
+    input.edge(0);
+    TEST_ASSERT_EQUAL_UINT32(count + 7, input.edge_count());
+    TEST_ASSERT_EQUAL_INT(1, rises);
+    TEST_ASSERT_EQUAL_INT(1, falls);
+
+    // counting stops capture
+    start_capture(capture_buffer);
+    input.count();
+    input.quiet();
+    input.edge(1);
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(0, batch_count);
+    TEST_ASSERT_EQUAL_UINT32(count + 8, input.edge_count());
+}
+
+// Windows of 10, 20, 30... rising edges, averaged over the last 4
+void test_case_frequency() {
+    input.reset();
+    frequency.start();
+    input.quiet();
+    TEST_ASSERT_FLOAT_WITHIN(0.0f, 0.0f, frequency.read());
+
+    uint32_t sent[6];
+    for (int window = 0; window < 6; window++) {
+        sent[window] = 10 * (window + 1);
+        for (uint32_t i = 0; i < sent[window]; i++) {
+            input.edge(1);
+            input.edge(0);
+        }
+        virtual_ticker_advance(1000);
+
+        uint32_t expected = 0;
+        int windows = window < 4 ? window + 1 : 4;
+        for (int w = window + 1 - windows; w <= window; w++) {
+            expected += sent[w];
+        }
+        uint32_t edges, span;
+        frequency.read_count(&edges, &span);
+        TEST_ASSERT_EQUAL_UINT32(expected, edges);
+        TEST_ASSERT_EQUAL_UINT32(1000 * windows, span);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, expected * 1000.0f / windows, frequency.read());
+    }
+
+    // no more counting once stopped
+    frequency.stop();
+    uint32_t count = input.edge_count();
+    input.edge(1);
+    TEST_ASSERT_EQUAL_UINT32(count, input.edge_count());
+    virtual_ticker_advance(1000);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 45000.0f, frequency.read());
+}
+
+// Bouncing edges reported once the input settles, if its level changed
+void test_case_debounce() {
+    input.reset();
+    rises = 0;
+    falls = 0;
+    input.rise(on_rise);
+    input.fall(on_fall);
+    input.debounce(500);
+    input.quiet();
+
+    // the interrupt is masked after the first edge, the bounces only change
+    // the level
+    input.edge(1);
+    virtual_ticker_advance(50);
+    input.level(0);
+    virtual_ticker_advance(50);
+    input.level(1);
+    virtual_ticker_advance(399);
+    TEST_ASSERT_EQUAL_INT(0, rises);
+    virtual_ticker_advance(1);
+    TEST_ASSERT_EQUAL_INT(1, rises);
+    TEST_ASSERT_EQUAL_INT(0, falls);
+
+    // a glitch settling back to the same level isn't an edge
+    input.edge(0);
+    virtual_ticker_advance(100);
+    input.level(1);
+    virtual_ticker_advance(500);
+    TEST_ASSERT_EQUAL_INT(1, rises);
+    TEST_ASSERT_EQUAL_INT(0, falls);
+
+    input.edge(0);
+    virtual_ticker_advance(500);
+    TEST_ASSERT_EQUAL_INT(1, rises);
+    TEST_ASSERT_EQUAL_INT(1, falls);
+
+    // captured with the time of the first edge
+    start_capture(capture_buffer);
+    input.debounce(500);
+    input.quiet();
+    timestamp_t start = virtual_ticker_read();
+    input.edge(1);
+    virtual_ticker_advance(20);
+    input.level(0);
+    virtual_ticker_advance(20);
+    input.level(1);
+    virtual_ticker_advance(500);
+    input.deliver();
+    TEST_ASSERT_EQUAL_INT(1, captured_count);
+    TEST_ASSERT_EQUAL_UINT32(start, captured[0].timestamp);
+    TEST_ASSERT_TRUE(captured[0].rise);
+}
+
+// Up to 4 edges a millisecond, masked for 2ms after more
+void test_case_storm() {
+    input.reset();
+    rises = 0;
+    input.rise(on_rise);
+    input.rate_limit(4, 2000);
+    input.quiet();
+    uint32_t storms = input.storms();
+
+    for (int ms = 0; ms < 3; ms++) {
+        for (int i = 0; i < 4; i++) {
+            input.edge(i % 2 == 0);
+        }
+        virtual_ticker_advance(1000);
+    }
+    TEST_ASSERT_EQUAL_INT(6, rises);
+    TEST_ASSERT_EQUAL_UINT32(storms, input.storms());
+
+    for (int i = 0; i < 5; i++) {
+        input.edge(i % 2 == 0);
+    }
+    TEST_ASSERT_EQUAL_INT(8, rises);
+    TEST_ASSERT_EQUAL_UINT32(storms + 1, input.storms());
+
+    // the edges are reported again after the holdoff
+    virtual_ticker_advance(2000);
+    TEST_ASSERT_EQUAL_INT(8, rises);
+    input.edge(0);
+    input.edge(1);
+    TEST_ASSERT_EQUAL_INT(9, rises);
+    TEST_ASSERT_EQUAL_UINT32(storms + 1, input.storms());
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("InterruptIn: capture wrapping around", test_case_capture_wrap, greentea_failure_handler),
+    Case("InterruptIn: capture overflow", test_case_capture_overflow, greentea_failure_handler),
+    Case("InterruptIn: capture restarted by the handler", test_case_capture_restart, greentea_failure_handler),
+    Case("InterruptIn: capture delivered by the completion task", test_case_capture_task, greentea_failure_handler),
+    Case("InterruptIn: counting", test_case_count, greentea_failure_handler),
+    Case("FrequencyCounter: averaging", test_case_frequency, greentea_failure_handler),
+    Case("InterruptIn: debounce", test_case_debounce, greentea_failure_handler),
+    Case("InterruptIn: storm masking", test_case_storm, greentea_failure_handler),
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(20, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}
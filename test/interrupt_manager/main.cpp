@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+#include "mbed-drivers/mbed.h"
+#include "mbed-drivers/InterruptManager.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+using namespace utest::v1;
+
+namespace {
+// the last vectors, which aren't enabled: the handlers are only called
+// through call_handlers()
+const IRQn_Type IRQ_A = (IRQn_Type)(NVIC_NUM_VECTORS - NVIC_USER_IRQ_OFFSET - 1);
+const IRQn_Type IRQ_B = (IRQn_Type)(NVIC_NUM_VECTORS - NVIC_USER_IRQ_OFFSET - 2);
+const int LOG_SIZE = 32;
+
+char log_buffer[LOG_SIZE];
+char taken[LOG_SIZE];
+int log_length;
+pFunctionPointer_t self;
+pFunctionPointer_t added;
+
+void log_call(char c) {
+    if (log_length < LOG_SIZE - 1) {
+        log_buffer[log_length++] = c;
+    }
+}
+
+// Get the calls logged since the last time
+const char *take_log() {
+    memcpy(taken, log_buffer, log_length);
+    taken[log_length] = '\0';
+    log_length = 0;
+    return taken;
+}
+
+void original() {
+    log_call('o');
+}
+
+void first() {
+    log_call('1');
+}
+
+void second() {
+    log_call('2');
+}
+
+void remove_self() {
+    log_call('r');
+    TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(self, IRQ_A));
+}
+
+// adds a handler to another interrupt, and removes it the next time
+void change_other() {
+    log_call('c');
+    if (NULL == added) {
+        added = InterruptManager::get()->add_handler(second, IRQ_B);
+        TEST_ASSERT_NOT_NULL(added);
+    } else {
+        TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(added, IRQ_B));
+        added = NULL;
+    }
+}
+
+class Member {
+public:
+    void handler() {
+        log_call('m');
+    }
+};
+
+Member member;
+
+void start() {
+    NVIC_SetVector(IRQ_A, (uint32_t)&original);
+    NVIC_SetVector(IRQ_B, (uint32_t)&original);
+    take_log();
+    TEST_ASSERT_EQUAL_INT(0, InterruptManager::shared_vectors());
+    TEST_ASSERT_EQUAL_INT(YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS, InterruptManager::get()->available_handlers());
+}
+
+void check_restored() {
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)&original, NVIC_GetVector(IRQ_A));
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)&original, NVIC_GetVector(IRQ_B));
+    TEST_ASSERT_EQUAL_INT(0, InterruptManager::shared_vectors());
+    TEST_ASSERT_EQUAL_INT(YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS, InterruptManager::get()->available_handlers());
+}
+}
+
+// The vector is chained with the first handler, and restored with the last
+void test_case_add_remove() {
+    start();
+    pFunctionPointer_t one = InterruptManager::get()->add_handler(first, IRQ_A);
+    TEST_ASSERT_NOT_NULL(one);
+    TEST_ASSERT_TRUE(NVIC_GetVector(IRQ_A) != (uint32_t)&original);
+    TEST_ASSERT_EQUAL_INT(1, InterruptManager::shared_vectors());
+    InterruptManager::call_handlers(IRQ_A);
+    TEST_ASSERT_EQUAL_INT(0, strcmp("o1", take_log()));
+
+    pFunctionPointer_t two = InterruptManager::get()->add_handler_front(second, IRQ_A);
+    pFunctionPointer_t m = InterruptManager::get()->add_handler(&member, &Member::handler, IRQ_A);
+    TEST_ASSERT_NOT_NULL(two);
+    TEST_ASSERT_NOT_NULL(m);
+    InterruptManager::call_handlers(IRQ_A);
+    TEST_ASSERT_EQUAL_INT(0, strcmp("2o1m", take_log()));
+    TEST_ASSERT_EQUAL_INT(1, InterruptManager::shared_vectors());
+
+    TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(two, IRQ_A));
+    TEST_ASSERT_FALSE(InterruptManager::get()->remove_handler(two, IRQ_A));
+    TEST_ASSERT_FALSE(InterruptManager::get()->remove_handler(one, IRQ_B));
+    TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(one, IRQ_A));
+    InterruptManager::call_handlers(IRQ_A);
+    TEST_ASSERT_EQUAL_INT(0, strcmp("om", take_log()));
+
+    // the original vector is called directly again
+    TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(m, IRQ_A));
+    check_restored();
+    InterruptManager::call_handlers(IRQ_A);
+    TEST_ASSERT_EQUAL_INT(0, strcmp("", take_log()));
+}
+
+// A chain left with a single handler while it runs is collapsed by the next
+// change
+void test_case_remove_from_handler() {
+    start();
+    self = InterruptManager::get()->add_handler(remove_self, IRQ_A);
+    InterruptManager::call_handlers(IRQ_A);
+    TEST_ASSERT_EQUAL_INT(0, strcmp("or", take_log()));
+    TEST_ASSERT_EQUAL_INT(1, InterruptManager::shared_vectors());
+    InterruptManager::call_handlers(IRQ_A);
+    TEST_ASSERT_EQUAL_INT(0, strcmp("o", take_log()));
+
+    pFunctionPointer_t one = InterruptManager::get()->add_handler(first, IRQ_B);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)&original, NVIC_GetVector(IRQ_A));
+    TEST_ASSERT_EQUAL_INT(1, InterruptManager::shared_vectors());
+    TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(one, IRQ_B));
+    check_restored();
+}
+
+// Handlers of one interrupt chaining and unchaining another
+void test_case_change_from_handler() {
+    start();
+    added = NULL;
+    pFunctionPointer_t c = InterruptManager::get()->add_handler(change_other, IRQ_A);
+    InterruptManager::call_handlers(IRQ_A);
+    TEST_ASSERT_EQUAL_INT(2, InterruptManager::shared_vectors());
+    InterruptManager::call_handlers(IRQ_B);
+    TEST_ASSERT_EQUAL_INT(0, strcmp("oco2", take_log()));
+
+    InterruptManager::call_handlers(IRQ_A);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)&original, NVIC_GetVector(IRQ_B));
+    TEST_ASSERT_EQUAL_INT(1, InterruptManager::shared_vectors());
+    TEST_ASSERT_EQUAL_INT(0, strcmp("oc", take_log()));
+    TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(c, IRQ_A));
+    check_restored();
+}
+
+// With all the handler slots taken, adding fails and leaves the vectors be
+void test_case_full() {
+    pFunctionPointer_t handlers[YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS];
+    int n = 0;
+
+    start();
+    while (n < YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS) {
+        handlers[n] = InterruptManager::get()->add_handler(first, IRQ_A);
+        if (NULL == handlers[n])
+            break;
+        n++;
+    }
+    // one slot holds the original vector
+    TEST_ASSERT_EQUAL_INT(YOTTA_CFG_MBED_DRIVERS_INTERRUPT_HANDLERS - 1, n);
+    TEST_ASSERT_NULL(InterruptManager::get()->add_handler(second, IRQ_B));
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)&original, NVIC_GetVector(IRQ_B));
+    TEST_ASSERT_EQUAL_INT(1, InterruptManager::shared_vectors());
+
+    for (int i = 0; i < n; i++) {
+        TEST_ASSERT_TRUE(InterruptManager::get()->remove_handler(handlers[i], IRQ_A));
+    }
+    check_restored();
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("InterruptManager: add and remove", test_case_add_remove, greentea_failure_handler),
+    Case("InterruptManager: removal from a handler", test_case_remove_from_handler, greentea_failure_handler),
+    Case("InterruptManager: changes from a handler", test_case_change_from_handler, greentea_failure_handler),
+    Case("InterruptManager: no room left", test_case_full, greentea_failure_handler),
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(20, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}
@@ -15,6 +15,8 @@
  * limitations under the License.
  */
 #include "mbed-drivers/mbed.h"
+#include "mbed-drivers/virtual_ticker.h"
+#include "mbed-drivers/ticker_api_ext.h"
 #include "greentea-client/test_env.h"
 #include "unity/unity.h"
 #include "utest/utest.h"
@@ -23,6 +25,67 @@ using namespace utest::v1;
 
 #define CUSTOM_TIME  1256729737
 
+namespace {
+// An RTC counting on the virtual ticker, faster or slower by drift_ppm
+us_timestamp_t rtc_start;
+time_t rtc_offset;
+int32_t rtc_drift_ppm;
+int rtc_reads;
+
+us_timestamp_t rtc_elapsed() {
+    int64_t elapsed = ticker_read_us64(get_virtual_ticker_data()) - rtc_start;
+    return elapsed + elapsed * rtc_drift_ppm / 1000000;
+}
+
+time_t fake_rtc_read() {
+    rtc_reads++;
+    return rtc_offset + rtc_elapsed() / 1000000;
+}
+
+void fake_rtc_write(time_t t) {
+    rtc_start = ticker_read_us64(get_virtual_ticker_data());
+    rtc_offset = t;
+}
+
+int fake_rtc_isenabled() {
+    return 1;
+}
+
+void use_fake_rtc(int32_t drift_ppm) {
+    rtc_drift_ppm = drift_ppm;
+    attach_rtc(fake_rtc_read, fake_rtc_write, NULL, fake_rtc_isenabled);
+    set_time_ticker(get_virtual_ticker_data());
+    set_time(CUSTOM_TIME);
+    rtc_reads = 0;
+}
+
+// Run for the given number of seconds in steps, checking the time never goes
+// back and stays within max_error seconds of the RTC. Returns the number of
+// steps where the time didn't move.
+int check_time(int seconds, timestamp_t step, int max_error) {
+    time_t last_s = 0;
+    uint32_t last_us = 0;
+    int held = 0;
+
+    for (us_timestamp_t elapsed = 0; elapsed < (us_timestamp_t)seconds * 1000000; elapsed += step) {
+        virtual_ticker_advance(step);
+        time_t s;
+        uint32_t us;
+        get_time_us(&s, &us);
+        TEST_ASSERT_TRUE(us < 1000000);
+        TEST_ASSERT_TRUE(s > last_s || (s == last_s && us >= last_us));
+        if (s == last_s && us == last_us) {
+            held++;
+        }
+        int error = (int)(s - (rtc_offset + (time_t)(rtc_elapsed() / 1000000)));
+        TEST_ASSERT_INT_WITHIN(max_error, 0, error);
+        last_s = s;
+        last_us = us;
+    }
+    return held;
+}
+}
+
 void test_case_rtc_strftime() {
     greentea_send_kv("timestamp", CUSTOM_TIME);
 
@@ -40,8 +103,54 @@ void test_case_rtc_strftime() {
     }
 }
 
+// Between the reads of the RTC, the time is counted on the ticker
+void test_case_time_cache() {
+    use_fake_rtc(0);
+    for (int i = 1; i < YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S * 10; i++) {
+        virtual_ticker_advance(100000);
+        uint32_t us;
+        TEST_ASSERT_EQUAL_INT(CUSTOM_TIME + i / 10, get_time_us(NULL, &us));
+        TEST_ASSERT_EQUAL_UINT32((i % 10) * 100000, us);
+    }
+    TEST_ASSERT_EQUAL_INT(0, rtc_reads);
+    virtual_ticker_advance(100000);
+    TEST_ASSERT_EQUAL_INT(CUSTOM_TIME + YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S, time(NULL));
+    TEST_ASSERT_EQUAL_INT(1, rtc_reads);
+}
+
+// An RTC 2% faster than the ticker moves the time forward at each read
+void test_case_time_resync_fast_rtc() {
+    use_fake_rtc(20000);
+    TEST_ASSERT_EQUAL_INT(0, check_time(10 * YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S, 50000, 2));
+    TEST_ASSERT_EQUAL_INT(10, rtc_reads);
+}
+
+// An RTC 2% slower than the ticker would move the time back at each read:
+// instead it holds it until the RTC catches up. The time gets 1.2 s ahead of
+// the RTC each minute, on top of the fractions of a second.
+void test_case_time_resync_slow_rtc() {
+    use_fake_rtc(-20000);
+    TEST_ASSERT_TRUE(check_time(10 * YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S, 50000, 3) > 0);
+    TEST_ASSERT_TRUE(rtc_reads >= 10);
+}
+
+// Without an RTC the time counts from the last set_time(), on the ticker only
+void test_case_time_no_rtc() {
+    attach_rtc(NULL, NULL, NULL, NULL);
+    set_time_ticker(get_virtual_ticker_data());
+    set_time(CUSTOM_TIME);
+    for (int i = 1; i <= 10 * YOTTA_CFG_MBED_DRIVERS_RTC_RESYNC_S; i++) {
+        virtual_ticker_advance(1000000);
+        TEST_ASSERT_EQUAL_INT(CUSTOM_TIME + i, time(NULL));
+    }
+}
+
 Case cases[] = {
     Case("RTC strftime", test_case_rtc_strftime),
+    Case("Time: cache between reads of the RTC", test_case_time_cache),
+    Case("Time: resync with a fast RTC", test_case_time_resync_fast_rtc),
+    Case("Time: resync with a slow RTC", test_case_time_resync_slow_rtc),
+    Case("Time: no RTC", test_case_time_no_rtc),
 };
 
 status_t greentea_test_setup(const size_t number_of_cases) {
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed-drivers/mbed.h"
+#include "PeripheralPins.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+using namespace utest::v1;
+
+#if DEVICE_SPI_ASYNCH
+namespace {
+const uint32_t QUEUE_SIZE = 3;
+// about 5ms at 100kHz, against about 32us at 1MHz
+const uint32_t LONG_SIZE = 64;
+const uint32_t SHORT_SIZE = 4;
+const int TIMEOUT_US = 1000000;
+
+uint8_t long_buffer[LONG_SIZE];
+uint8_t short_buffer[SHORT_SIZE];
+
+// An SPI telling whether its physical peripheral is transferring. The
+// transfers only write, to the MOSI pin of the peripheral.
+class TestSPI : public SPI {
+public:
+    TestSPI(PinName mosi, PinName sclk) : SPI(mosi, NC, sclk) {
+    }
+
+    bool busy() const {
+        return _bus->busy;
+    }
+};
+
+// The SPI objects outlive the cases, for the completions delivered later
+TestSPI *slow;
+TestSPI *fast;
+TestSPI *slow_shared;
+
+// The completions are delivered by minar, after the cases
+void on_complete(Buffer, Buffer, int) {
+}
+
+int send(TestSPI *spi, uint8_t *buffer, uint32_t size) {
+    return spi->transfer()
+        .tx(buffer, size)
+        .callback(SPI::event_callback_t(on_complete), SPI_EVENT_COMPLETE)
+        .apply();
+}
+
+// Find the MOSI and SCLK pins of the n-th physical SPI peripheral of the
+// pinmaps
+bool find_bus(int n, PinName *mosi, PinName *sclk) {
+    for (int i = 0; PinMap_SPI_MOSI[i].pin != NC; i++) {
+        int first = 0;
+        while (PinMap_SPI_MOSI[first].peripheral != PinMap_SPI_MOSI[i].peripheral) {
+            first++;
+        }
+        if (first != i || n-- > 0) {
+            continue;
+        }
+        *mosi = PinMap_SPI_MOSI[i].pin;
+        for (int j = 0; PinMap_SPI_SCLK[j].pin != NC; j++) {
+            if (PinMap_SPI_SCLK[j].peripheral == PinMap_SPI_MOSI[i].peripheral) {
+                *sclk = PinMap_SPI_SCLK[j].pin;
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+// Wait for the peripheral of the SPI to finish its transfers
+bool wait_idle(TestSPI *spi) {
+    Timer timer;
+    timer.start();
+    while (spi->busy() && timer.read_us() < TIMEOUT_US) {
+    }
+    return !spi->busy();
+}
+
+bool start() {
+    if (slow == NULL) {
+        PinName slow_mosi, slow_sclk, fast_mosi, fast_sclk;
+        if (!find_bus(0, &slow_mosi, &slow_sclk) || !find_bus(1, &fast_mosi, &fast_sclk)) {
+            printf("fewer than two SPI peripherals, skipped\r\n");
+            return false;
+        }
+        slow = new TestSPI(slow_mosi, slow_sclk);
+        slow_shared = new TestSPI(slow_mosi, slow_sclk);
+        fast = new TestSPI(fast_mosi, fast_sclk);
+        slow->frequency(100000);
+        slow_shared->frequency(100000);
+        fast->frequency(1000000);
+    }
+    TEST_ASSERT_TRUE(wait_idle(slow));
+    TEST_ASSERT_TRUE(wait_idle(fast));
+    TEST_ASSERT_EQUAL_INT(0, slow->set_transfer_queue_size(QUEUE_SIZE));
+    TEST_ASSERT_EQUAL_INT(0, fast->set_transfer_queue_size(QUEUE_SIZE));
+    slow->reset_transfer_queue_stats();
+    fast->reset_transfer_queue_stats();
+    return true;
+}
+}
+
+// A slow peripheral doesn't hold the transfers of another one back
+void test_case_two_buses() {
+    if (!start()) {
+        return;
+    }
+    for (uint32_t i = 0; i <= QUEUE_SIZE; i++) {
+        TEST_ASSERT_EQUAL_INT(0, send(slow, long_buffer, LONG_SIZE));
+    }
+    for (uint32_t i = 0; i <= QUEUE_SIZE; i++) {
+        TEST_ASSERT_EQUAL_INT(0, send(fast, short_buffer, SHORT_SIZE));
+    }
+
+    TEST_ASSERT_TRUE(wait_idle(fast));
+    TEST_ASSERT_EQUAL_UINT32(0, fast->transfer_queue_depth());
+    TEST_ASSERT_TRUE(slow->busy());
+    TEST_ASSERT_TRUE(slow->transfer_queue_depth() > 0);
+
+    TEST_ASSERT_TRUE(wait_idle(slow));
+    TEST_ASSERT_EQUAL_UINT32(0, slow->transfer_queue_depth());
+    TEST_ASSERT_EQUAL_UINT32(0, slow->transfer_queue_overflows());
+    TEST_ASSERT_EQUAL_UINT32(0, fast->transfer_queue_overflows());
+}
+
+// The statistics are those of the peripheral, whichever SPI queued
+void test_case_stats() {
+    if (!start()) {
+        return;
+    }
+    // the first transfer starts, the next ones wait, the last ones are refused
+    for (uint32_t i = 0; i <= QUEUE_SIZE; i++) {
+        TEST_ASSERT_EQUAL_INT(0, send(i & 1 ? slow_shared : slow, long_buffer, LONG_SIZE));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, send(slow_shared, long_buffer, LONG_SIZE));
+    TEST_ASSERT_EQUAL_INT(-1, send(slow, long_buffer, LONG_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(QUEUE_SIZE, slow_shared->transfer_queue_depth());
+    TEST_ASSERT_EQUAL_UINT32(QUEUE_SIZE, slow->transfer_queue_high_water());
+    TEST_ASSERT_EQUAL_UINT32(2, slow_shared->transfer_queue_overflows());
+    TEST_ASSERT_EQUAL_UINT32(0, fast->transfer_queue_high_water());
+    TEST_ASSERT_EQUAL_INT(-1, slow->set_transfer_queue_size(QUEUE_SIZE + 1));
+
+    TEST_ASSERT_TRUE(wait_idle(slow));
+    TEST_ASSERT_EQUAL_UINT32(0, slow->transfer_queue_depth());
+    TEST_ASSERT_EQUAL_UINT32(QUEUE_SIZE, slow->transfer_queue_high_water());
+    slow_shared->reset_transfer_queue_stats();
+    TEST_ASSERT_EQUAL_UINT32(0, slow->transfer_queue_high_water());
+    TEST_ASSERT_EQUAL_UINT32(0, slow->transfer_queue_overflows());
+
+    // a larger queue
+    TEST_ASSERT_EQUAL_INT(0, slow->set_transfer_queue_size(QUEUE_SIZE + 1));
+    for (uint32_t i = 0; i <= QUEUE_SIZE + 1; i++) {
+        TEST_ASSERT_EQUAL_INT(0, send(slow, long_buffer, LONG_SIZE));
+    }
+    TEST_ASSERT_EQUAL_UINT32(QUEUE_SIZE + 1, slow->transfer_queue_high_water());
+    TEST_ASSERT_TRUE(wait_idle(slow));
+}
+#else
+void test_case_skipped() {
+    printf("no asynchronous SPI, skipped\r\n");
+}
+#endif
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+#if DEVICE_SPI_ASYNCH
+    Case("SPI: two buses", test_case_two_buses, greentea_failure_handler),
+    Case("SPI: transfer queue statistics", test_case_stats, greentea_failure_handler),
+#else
+    Case("SPI: skipped", test_case_skipped, greentea_failure_handler),
+#endif
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(20, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include "mbed-drivers/mbed.h"
+#include "mbed-drivers/ticker_api_ext.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+using namespace utest::v1;
+
+namespace {
+const int MAX_EVENTS = 1000;
+const int ROUNDS = 10;
+
+ticker_event_t events[MAX_EVENTS];
+ticker_queue_t indexed_queue;
+ticker_queue_t list_queue;
+
+// The queues under test never fire, they only need a ticker interface
+void null_init(void) {}
+uint32_t null_read(void) { return 0; }
+void null_interrupt(void) {}
+void null_set_interrupt(timestamp_t) {}
+
+const ticker_interface_t null_interface = {
+    null_init, null_read, null_interrupt, null_interrupt, null_set_interrupt
+};
+const ticker_data_t indexed_data = { &null_interface, &indexed_queue.queue };
+const ticker_data_t list_data = { &null_interface, &list_queue.queue };
+}
+
+// xorshift32, so that both queues see the same sequence of timestamps
+uint32_t next_random(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void check_sorted(const ticker_data_t *data, int count) {
+    int n = 0;
+    for (ticker_event_t *p = data->queue->head; p != NULL; p = p->next, n++) {
+        if (p->next != NULL) {
+            TEST_ASSERT_TRUE((int)(p->next->timestamp - p->timestamp) >= 0);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(count, n);
+}
+
+// Insert count events at random timestamps then remove them in another order,
+// returns the average time of one insert or remove in nanoseconds
+int measure(const ticker_data_t *data, int count) {
+    uint32_t seed = 0x2545F491;
+    Timer timer;
+
+    for (int r = 0; r < ROUNDS; r++) {
+        timer.start();
+        for (int i = 0; i < count; i++) {
+            ticker_insert_event(data, &events[i], next_random(seed) % 1000000, i);
+        }
+        timer.stop();
+        check_sorted(data, count);
+        TEST_ASSERT_EQUAL_UINT32(count, ticker_get_queue_length(data));
+        timer.start();
+        for (int i = 0; i < count; i++) {
+            // 7 is coprime with all the sizes used, so every event is removed
+            ticker_remove_event(data, &events[(i * 7) % count]);
+        }
+        timer.stop();
+        TEST_ASSERT_NULL(data->queue->head);
+    }
+    return (timer.read_us() * 1000) / (ROUNDS * 2 * count);
+}
+
+template <int N>
+void test_case_ticker_queue() {
+    char key[32];
+
+    list_queue.flags = TICKER_QUEUE_FLAG_NO_INDEX;
+    int list_ns = measure(&list_data, N);
+    int indexed_ns = measure(&indexed_data, N);
+
+    snprintf(key, sizeof(key), "list_ns_per_op_%d", N);
+    greentea_send_kv(key, list_ns);
+    snprintf(key, sizeof(key), "indexed_ns_per_op_%d", N);
+    greentea_send_kv(key, indexed_ns);
+}
+
+int dispatched;
+
+// Re-arms every other event, like a periodic Ticker would
+void burst_handler(uint32_t id) {
+    dispatched++;
+    if (id % 2 == 0) {
+        ticker_insert_event(&indexed_data, &events[id], 1000, id);
+    }
+}
+
+// A burst of events due at once runs in a single pass, and the events
+// re-armed by the handlers are merged back into the queue
+void test_case_ticker_dispatch() {
+    ticker_stats_t stats;
+
+    indexed_queue.queue.event_handler = burst_handler;
+    for (int i = 0; i < MAX_EVENTS; i++) {
+        ticker_insert_event(&indexed_data, &events[i], 0, i);
+    }
+    dispatched = 0;
+    ticker_irq_handler(&indexed_data);
+    TEST_ASSERT_EQUAL_INT(MAX_EVENTS, dispatched);
+    check_sorted(&indexed_data, MAX_EVENTS / 2);
+
+    ticker_get_stats(&indexed_data, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.irqs);
+    TEST_ASSERT_EQUAL_UINT32(MAX_EVENTS, stats.irq_events);
+    for (int i = 0; i < MAX_EVENTS; i += 2) {
+        ticker_remove_event(&indexed_data, &events[i]);
+    }
+    TEST_ASSERT_NULL(indexed_data.queue->head);
+    indexed_queue.queue.event_handler = NULL;
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("Ticker queue: 10 events", test_case_ticker_queue<10>, greentea_failure_handler),
+    Case("Ticker queue: 100 events", test_case_ticker_queue<100>, greentea_failure_handler),
+    Case("Ticker queue: 1000 events", test_case_ticker_queue<1000>, greentea_failure_handler),
+    Case("Ticker queue: batched dispatch", test_case_ticker_dispatch, greentea_failure_handler),
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(30, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}
@@ -0,0 +1,847 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include "mbed-drivers/mbed.h"
+#include "mbed-drivers/virtual_ticker.h"
+#include "mbed-drivers/CompletionQueue.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+using namespace utest::v1;
+
+namespace {
+const int TIMEOUTS = 100;
+const int STRESS_EVENTS = 1000000;
+const int OVERRUN_CALLS = 16;
+const int WHEEL_TIMEOUTS = 64;
+const int WHEEL_REARMS = 4;
+// the ticks covered by the three levels of the wheel
+const uint32_t WHEEL_RANGE = 1u << 18;
+
+timestamp_t fired_at;
+int fired;
+int stress_calls;
+
+void on_fire() {
+    fired_at = virtual_ticker_read();
+    fired++;
+}
+
+// A Timeout which re-arms itself with a pseudo-random delay, and checks it
+// is called at exactly its deadline
+class Rearming {
+public:
+    Rearming() : _timeout(get_virtual_ticker_data()), _state(0), _deadline(0), _late(0) {
+    }
+
+    void start(uint32_t seed) {
+        _state = seed;
+        arm();
+    }
+
+    void stop() {
+        _timeout.detach();
+    }
+
+    void on_timeout() {
+        if (virtual_ticker_read() != _deadline) {
+            _late++;
+        }
+        stress_calls++;
+        arm();
+    }
+
+    int late() const {
+        return _late;
+    }
+
+private:
+    void arm() {
+        // xorshift32
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        timestamp_t delay = 1 + _state % 10000;
+        _deadline = virtual_ticker_read() + delay;
+        _timeout.attach_us(this, &Rearming::on_timeout, delay);
+    }
+
+    Timeout _timeout;
+    uint32_t _state;
+    timestamp_t _deadline;
+    int _late;
+};
+
+Rearming rearming[TIMEOUTS];
+
+// A Ticker every 100 ticks whose third call takes 350 ticks
+Ticker overrun_ticker(get_virtual_ticker_data());
+timestamp_t overrun_start;
+timestamp_t overrun_calls[OVERRUN_CALLS];
+int overrun_count;
+
+void on_overrun_tick() {
+    if (overrun_count < OVERRUN_CALLS) {
+        overrun_calls[overrun_count] = virtual_ticker_read() - overrun_start;
+    }
+    overrun_count++;
+    if (overrun_count == 3) {
+        virtual_ticker_delay(350);
+    }
+}
+
+// Run overrun_ticker for 1000 ticks under policy, and check the times of
+// its calls and its counters
+void check_overrun(Ticker::OverrunPolicy policy, const timestamp_t *expected, int calls,
+                   uint32_t overruns, uint32_t missed) {
+    overrun_count = 0;
+    overrun_start = virtual_ticker_read();
+    overrun_ticker.reset_overrun_counters();
+    overrun_ticker.set_overrun_policy(policy);
+    overrun_ticker.attach_us(on_overrun_tick, 100);
+    virtual_ticker_advance(1000);
+    overrun_ticker.detach();
+
+    TEST_ASSERT_EQUAL_INT(calls, overrun_count);
+    for (int i = 0; i < calls; i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i], overrun_calls[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(overruns, overrun_ticker.overruns());
+    TEST_ASSERT_EQUAL_UINT32(missed, overrun_ticker.missed_ticks());
+}
+
+TimerWheel wheel(get_virtual_ticker_data());
+uint32_t wheel_state = 0x9E3779B9;
+
+// Delays from one wheel tick up to twice the range of the wheel
+timestamp_t wheel_delay() {
+    wheel_state ^= wheel_state << 13;
+    wheel_state ^= wheel_state >> 17;
+    wheel_state ^= wheel_state << 5;
+    return TimerWheel::resolution() + wheel_state % (2 * WHEEL_RANGE * TimerWheel::resolution());
+}
+
+// A Timeout on the wheel, which checks it is called at most a wheel tick
+// after its deadline, and may re-arm itself with a random delay
+class WheelTimeout {
+public:
+    WheelTimeout() : _timeout(wheel), _deadline(0), _calls(0), _early(0), _late(0), _rearms(0) {
+    }
+
+    void start(timestamp_t delay, int rearms = 0) {
+        _rearms = rearms;
+        arm(delay);
+    }
+
+    void stop() {
+        _timeout.detach();
+    }
+
+    void on_timeout() {
+        int late = (int)(virtual_ticker_read() - _deadline);
+        if (late < 0) {
+            _early++;
+        } else if (late > (int)TimerWheel::resolution()) {
+            _late++;
+        }
+        _calls++;
+        if (_rearms > 0) {
+            _rearms--;
+            arm(wheel_delay());
+        }
+    }
+
+    int calls() const {
+        return _calls;
+    }
+
+    int early() const {
+        return _early;
+    }
+
+    int late() const {
+        return _late;
+    }
+
+    void reset() {
+        _calls = 0;
+        _early = 0;
+        _late = 0;
+    }
+
+private:
+    void arm(timestamp_t delay) {
+        _deadline = virtual_ticker_read() + delay;
+        _timeout.attach_us(this, &WheelTimeout::on_timeout, delay);
+    }
+
+    Timeout _timeout;
+    timestamp_t _deadline;
+    int _calls;
+    int _early;
+    int _late;
+    int _rearms;
+};
+
+WheelTimeout wheel_timeouts[WHEEL_TIMEOUTS];
+
+// Deadlines on either side of the boundaries between the levels, and past
+// the range of the wheel, in ticks
+const uint32_t wheel_ticks[] = {
+    1, 2, 63, 64, 65, 4095, 4096, 4097, 100000, WHEEL_RANGE - 1, WHEEL_RANGE, WHEEL_RANGE + 1, 3 * WHEEL_RANGE / 2
+};
+const int WHEEL_TICKS = sizeof(wheel_ticks) / sizeof(wheel_ticks[0]);
+
+void reset_wheel_timeouts() {
+    for (int i = 0; i < WHEEL_TIMEOUTS; i++) {
+        wheel_timeouts[i].stop();
+        wheel_timeouts[i].reset();
+    }
+}
+
+// A TimerEvent inserted with slack, which records when it fires
+class SlackEvent : public TimerEvent {
+public:
+    SlackEvent() : TimerEvent(get_virtual_ticker_data()), _fired_at(0), _calls(0) {
+    }
+
+    void start(timestamp_t deadline, timestamp_t slack) {
+        _calls = 0;
+        insert(deadline, slack);
+    }
+
+    timestamp_t fired_at() const {
+        return _fired_at;
+    }
+
+    int calls() const {
+        return _calls;
+    }
+
+protected:
+    virtual void handler() {
+        _fired_at = virtual_ticker_read();
+        _calls++;
+    }
+
+private:
+    timestamp_t _fired_at;
+    int _calls;
+};
+
+// Move the virtual time to t, in steps the signed deadline comparisons of the
+// ticker can tell apart
+void advance_to(timestamp_t t) {
+    while (t - virtual_ticker_read() > 0x40000000) {
+        virtual_ticker_advance(0x40000000);
+    }
+    virtual_ticker_advance(t - virtual_ticker_read());
+}
+
+// Move the virtual time on by a 64-bit number of ticks
+void advance_us64(us_timestamp_t ticks) {
+    while (ticks > 0x40000000) {
+        virtual_ticker_advance(0x40000000);
+        ticks -= 0x40000000;
+    }
+    virtual_ticker_advance((timestamp_t)ticks);
+}
+
+us_timestamp_t fired_at64;
+
+void on_fire64() {
+    fired_at64 = ticker_read_us64(get_virtual_ticker_data());
+    fired++;
+}
+
+// Far deadlines on the virtual ticker wait on the virtual low power ticker
+void pair_lp() {
+    ticker_set_low_power(get_virtual_ticker_data(), get_virtual_lp_ticker_data());
+}
+
+void unpair_lp() {
+    ticker_set_low_power(get_virtual_ticker_data(), NULL);
+    virtual_lp_ticker_set_drift(0);
+}
+
+uint32_t us_queue_length() {
+    return ticker_get_queue_length(get_virtual_ticker_data());
+}
+
+uint32_t lp_queue_length() {
+    return ticker_get_queue_length(get_virtual_lp_ticker_data());
+}
+
+// How long before its deadline an event moves back from the low power ticker
+timestamp_t lp_margin(timestamp_t delay) {
+    return YOTTA_CFG_MBED_DRIVERS_LP_TICKER_HANDOVER_US + (delay >> 10);
+}
+
+Timeout *far_timeout;
+
+void detach_far() {
+    far_timeout->detach();
+    fired_at = virtual_ticker_read();
+}
+
+SlackEvent slack_a;
+SlackEvent slack_b;
+SlackEvent slack_c;
+ticker_stats_t slack_stats;
+
+void start_slack_stats() {
+    ticker_get_stats(get_virtual_ticker_data(), &slack_stats);
+}
+
+// Check the interrupts and coalesced events since start_slack_stats()
+void check_slack_stats(uint32_t irqs, uint32_t coalesced) {
+    ticker_stats_t stats;
+    ticker_get_stats(get_virtual_ticker_data(), &stats);
+    TEST_ASSERT_EQUAL_UINT32(irqs, stats.irqs - slack_stats.irqs);
+    TEST_ASSERT_EQUAL_UINT32(coalesced, stats.coalesced - slack_stats.coalesced);
+}
+
+const timestamp_t DEFERRED_PERIOD = 1000;
+int lp_fired;
+
+void on_lp_fire() {
+    lp_fired++;
+}
+
+// Runs the completion task from the test, rather than from minar
+class CompletionTask : public CompletionSource {
+public:
+    static void run() {
+        CompletionSource::run();
+    }
+};
+
+uint32_t wakeups_since(uint32_t wakeups) {
+    return CompletionSource::wakeups() - wakeups;
+}
+}
+
+void test_case_timeout() {
+    Timeout timeout(get_virtual_ticker_data());
+    Timer timer(get_virtual_ticker_data());
+    timestamp_t start = virtual_ticker_read();
+
+    fired = 0;
+    timer.start();
+    timeout.attach_us(on_fire, 1000);
+    virtual_ticker_advance(999);
+    TEST_ASSERT_EQUAL_INT(0, fired);
+    virtual_ticker_advance(1);
+    TEST_ASSERT_EQUAL_INT(1, fired);
+    TEST_ASSERT_EQUAL_UINT32(start + 1000, fired_at);
+    virtual_ticker_advance(123456);
+    TEST_ASSERT_EQUAL_INT(1, fired);
+    TEST_ASSERT_EQUAL_INT(124456, timer.read_us());
+}
+
+void test_case_ticker() {
+    Ticker ticker(get_virtual_ticker_data());
+    timestamp_t start = virtual_ticker_read();
+
+    fired = 0;
+    ticker.attach_us(on_fire, 100);
+    virtual_ticker_advance(1000000);
+    TEST_ASSERT_EQUAL_INT(10000, fired);
+    TEST_ASSERT_EQUAL_UINT32(start + 1000000, fired_at);
+    ticker.detach();
+    virtual_ticker_advance(1000);
+    TEST_ASSERT_EQUAL_INT(10000, fired);
+}
+
+// Timeouts re-arming themselves as fast as the CPU allows
+void test_case_stress() {
+    Timer timer;
+    stress_calls = 0;
+    for (int i = 0; i < TIMEOUTS; i++) {
+        rearming[i].start(0x2545F491 + i);
+    }
+    timer.start();
+    while (stress_calls < STRESS_EVENTS) {
+        TEST_ASSERT_EQUAL_INT(1, virtual_ticker_run_next());
+    }
+    timer.stop();
+    for (int i = 0; i < TIMEOUTS; i++) {
+        rearming[i].stop();
+        TEST_ASSERT_EQUAL_INT(0, rearming[i].late());
+    }
+
+    int ms = timer.read_ms();
+    greentea_send_kv("virtual_events_per_s", ms > 0 ? (int)((uint64_t)stress_calls * 1000 / ms) : stress_calls);
+}
+
+// The missed calls are made back to back, then the schedule goes on
+void test_case_overrun_catch_up() {
+    const timestamp_t expected[] = {100, 200, 300, 650, 650, 650, 700, 800, 900, 1000};
+    check_overrun(Ticker::CatchUp, expected, 10, 2, 0);
+}
+
+// The missed calls are dropped, and the original schedule kept
+void test_case_overrun_skip() {
+    const timestamp_t expected[] = {100, 200, 300, 650, 700, 800, 900, 1000};
+    check_overrun(Ticker::Skip, expected, 8, 1, 2);
+}
+
+// The missed calls are dropped, and the schedule restarts from the late call
+void test_case_overrun_realign() {
+    const timestamp_t expected[] = {100, 200, 300, 650, 750, 850, 950};
+    check_overrun(Ticker::Realign, expected, 7, 1, 2);
+}
+
+// One Timeout per deadline, cascading down from every level of the wheel
+void test_case_wheel_levels() {
+    reset_wheel_timeouts();
+    // don't start on a tick boundary
+    virtual_ticker_advance(TimerWheel::resolution() / 3);
+    for (int i = 0; i < WHEEL_TICKS; i++) {
+        wheel_timeouts[i].start(wheel_ticks[i] * TimerWheel::resolution() + 7 * i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(WHEEL_TICKS, wheel.size());
+
+    // step through the levels, so each Timeout is seen cascading
+    for (uint32_t step = 0; step < 4 * WHEEL_RANGE / 1000; step++) {
+        virtual_ticker_advance(1000 * TimerWheel::resolution());
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.size());
+    for (int i = 0; i < WHEEL_TICKS; i++) {
+        TEST_ASSERT_EQUAL_INT(1, wheel_timeouts[i].calls());
+        TEST_ASSERT_EQUAL_INT(0, wheel_timeouts[i].early());
+        TEST_ASSERT_EQUAL_INT(0, wheel_timeouts[i].late());
+    }
+}
+
+// Timeouts detached from each level, before and after they were cascaded
+void test_case_wheel_cancel() {
+    reset_wheel_timeouts();
+    for (int i = 0; i < WHEEL_TICKS; i++) {
+        wheel_timeouts[i].start(wheel_ticks[i] * TimerWheel::resolution());
+    }
+    for (int i = 0; i < WHEEL_TICKS; i += 2) {
+        wheel_timeouts[i].stop();
+    }
+    TEST_ASSERT_EQUAL_UINT32(WHEEL_TICKS / 2, wheel.size());
+
+    // move past the first levels, so the far Timeouts have been cascaded
+    // at least once, then detach half of what is left
+    virtual_ticker_advance((WHEEL_RANGE / 2) * TimerWheel::resolution());
+    uint32_t left = wheel.size();
+    for (int i = 1; i < WHEEL_TICKS; i += 4) {
+        if (wheel_timeouts[i].calls() == 0) {
+            wheel_timeouts[i].stop();
+            left--;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(left, wheel.size());
+
+    virtual_ticker_advance(2 * WHEEL_RANGE * TimerWheel::resolution());
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.size());
+    for (int i = 0; i < WHEEL_TICKS; i++) {
+        bool detached = (i % 2 == 0) || (i % 4 == 1 && wheel_ticks[i] >= WHEEL_RANGE / 2);
+        TEST_ASSERT_EQUAL_INT(detached ? 0 : 1, wheel_timeouts[i].calls());
+        TEST_ASSERT_EQUAL_INT(0, wheel_timeouts[i].early());
+        TEST_ASSERT_EQUAL_INT(0, wheel_timeouts[i].late());
+    }
+}
+
+// Timeouts re-arming themselves on the wheel with delays up to twice its
+// range, while time moves on in uneven steps
+void test_case_wheel_random() {
+    reset_wheel_timeouts();
+    for (int i = 0; i < WHEEL_TIMEOUTS; i++) {
+        wheel_timeouts[i].start(wheel_delay(), WHEEL_REARMS);
+    }
+    // go one tick past the last possible deadline
+    for (uint32_t elapsed = 0; elapsed <= 2 * (WHEEL_REARMS + 1) * WHEEL_RANGE + 1; ) {
+        uint32_t ticks = 1 + wheel_delay() % 5000;
+        virtual_ticker_advance(ticks * TimerWheel::resolution() + wheel_delay() % TimerWheel::resolution());
+        elapsed += ticks;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.size());
+    for (int i = 0; i < WHEEL_TIMEOUTS; i++) {
+        TEST_ASSERT_EQUAL_INT(WHEEL_REARMS + 1, wheel_timeouts[i].calls());
+        TEST_ASSERT_EQUAL_INT(0, wheel_timeouts[i].early());
+        TEST_ASSERT_EQUAL_INT(0, wheel_timeouts[i].late());
+    }
+}
+
+// Events whose windows hold the deadline of another event share its
+// interrupt, including a window starting on that deadline
+void test_case_slack_overlapping() {
+    timestamp_t start = virtual_ticker_read();
+
+    start_slack_stats();
+    slack_a.start(start + 1000, 0);
+    slack_b.start(start + 900, 200);
+    slack_c.start(start + 1000, 50);
+    TEST_ASSERT_EQUAL_UINT32(1, virtual_ticker_advance(2000));
+    TEST_ASSERT_EQUAL_INT(1, slack_a.calls());
+    TEST_ASSERT_EQUAL_INT(1, slack_b.calls());
+    TEST_ASSERT_EQUAL_INT(1, slack_c.calls());
+    TEST_ASSERT_EQUAL_UINT32(start + 1000, slack_a.fired_at());
+    TEST_ASSERT_EQUAL_UINT32(start + 1000, slack_b.fired_at());
+    TEST_ASSERT_EQUAL_UINT32(start + 1000, slack_c.fired_at());
+    check_slack_stats(1, 1);
+}
+
+// Events whose windows hold no other deadline fire on their own, within
+// their window
+void test_case_slack_separate() {
+    timestamp_t start = virtual_ticker_read();
+
+    start_slack_stats();
+    slack_a.start(start + 1000, 0);
+    slack_b.start(start + 500, 200);
+    slack_c.start(start + 1001, 100);
+    TEST_ASSERT_EQUAL_UINT32(3, virtual_ticker_advance(2000));
+    TEST_ASSERT_EQUAL_UINT32(start + 1000, slack_a.fired_at());
+    TEST_ASSERT_TRUE(slack_b.fired_at() - (start + 500) <= 200);
+    TEST_ASSERT_TRUE(slack_c.fired_at() - (start + 1001) <= 100);
+    check_slack_stats(3, 0);
+}
+
+// Windows spanning the wrap of the 32-bit ticker. The keepalive event is
+// queued every TICKER_KEEPALIVE_INTERVAL ticks from the start of the virtual
+// time, so one is due right at the wrap.
+void test_case_slack_wrap() {
+    advance_to(0xFFFFF000);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFF000, virtual_ticker_read());
+
+    // coalesced with an event due before the wrap
+    start_slack_stats();
+    slack_a.start(0xFFFFFFF0, 0);
+    slack_b.start(0xFFFFFF80, 0x100);
+    TEST_ASSERT_EQUAL_INT(1, virtual_ticker_run_next());
+    TEST_ASSERT_EQUAL_INT(1, slack_a.calls());
+    TEST_ASSERT_EQUAL_INT(1, slack_b.calls());
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFF0, slack_a.fired_at());
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFF0, slack_b.fired_at());
+    check_slack_stats(1, 1);
+
+    // coalesced with the keepalive event, due after the wrap
+    start_slack_stats();
+    slack_c.start(0xFFFFFFF8, 0x100);
+    TEST_ASSERT_EQUAL_INT(1, virtual_ticker_run_next());
+    TEST_ASSERT_EQUAL_INT(1, slack_c.calls());
+    TEST_ASSERT_EQUAL_UINT32(0, slack_c.fired_at());
+    check_slack_stats(1, 1);
+
+    // alone, rounded up to the roundest time of its window
+    advance_to(0x1000);
+    start_slack_stats();
+    slack_c.start(0x1F00, 0x200);
+    TEST_ASSERT_EQUAL_UINT32(1, virtual_ticker_advance(0x2000));
+    TEST_ASSERT_EQUAL_INT(1, slack_c.calls());
+    TEST_ASSERT_EQUAL_UINT32(0x2000, slack_c.fired_at());
+    check_slack_stats(1, 0);
+}
+
+// The 64-bit time counts every wrap of the 32-bit ticker, even when it isn't
+// read in between
+void test_case_us64_wraps() {
+    const ticker_data_t *data = get_virtual_ticker_data();
+    us_timestamp_t start = ticker_read_us64(data);
+
+    advance_us64(5ULL << 32);
+    TEST_ASSERT_TRUE(ticker_read_us64(data) - start == (5ULL << 32));
+    advance_us64(0x12345678);
+    us_timestamp_t now = ticker_read_us64(data);
+    TEST_ASSERT_TRUE(now - start == (5ULL << 32) + 0x12345678);
+    TEST_ASSERT_EQUAL_UINT32(virtual_ticker_read(), (timestamp_t)now);
+}
+
+// With no other event queued, the keepalive event keeps the ticker interrupt
+// armed, and is queued again every time it fires
+void test_case_us64_keepalive() {
+    timestamp_t deadline;
+
+    TEST_ASSERT_EQUAL_UINT32(0, ticker_get_queue_length(get_virtual_ticker_data()));
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(1, virtual_ticker_get_deadline(&deadline));
+        TEST_ASSERT_TRUE(deadline - virtual_ticker_read() <= TICKER_KEEPALIVE_INTERVAL);
+        TEST_ASSERT_EQUAL_UINT32(1, virtual_ticker_advance(deadline - virtual_ticker_read()));
+        TEST_ASSERT_EQUAL_INT(1, virtual_ticker_get_deadline(&deadline));
+        TEST_ASSERT_EQUAL_UINT32(virtual_ticker_read() + TICKER_KEEPALIVE_INTERVAL, deadline);
+    }
+}
+
+// A deadline further than the 32-bit ticker can tell is reached through
+// intermediate events, which don't call the handler
+void test_case_us64_far_deadline() {
+    Timeout timeout(get_virtual_ticker_data());
+    const us_timestamp_t delay = (3ULL << 31) + 12345;
+    us_timestamp_t start = ticker_read_us64(get_virtual_ticker_data());
+
+    fired = 0;
+    timeout.attach_us64(on_fire64, delay);
+    advance_us64(delay - 1);
+    TEST_ASSERT_EQUAL_INT(0, fired);
+    advance_us64(1);
+    TEST_ASSERT_EQUAL_INT(1, fired);
+    TEST_ASSERT_TRUE(fired_at64 - start == delay);
+    advance_us64(delay);
+    TEST_ASSERT_EQUAL_INT(1, fired);
+}
+
+// Timer doesn't wrap after 2^31 us, about 35 minutes
+void test_case_us64_timer() {
+    Timer timer(get_virtual_ticker_data());
+    const us_timestamp_t three_hours = 3ULL * 3600 * 1000000;
+
+    timer.start();
+    advance_us64(three_hours);
+    TEST_ASSERT_TRUE(timer.read_high_resolution_us() == three_hours);
+    TEST_ASSERT_EQUAL_INT(3 * 3600 * 1000, timer.read_ms());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 3 * 3600.0f, timer.read());
+
+    // stopped time isn't counted
+    timer.stop();
+    advance_us64(three_hours);
+    timer.start();
+    advance_us64(three_hours);
+    TEST_ASSERT_TRUE(timer.read_high_resolution_us() == 2 * three_hours);
+}
+
+// Far deadlines wait on the low power ticker, which is only set up then,
+// and move back to the virtual ticker shortly before the deadline
+void test_case_lp_migration() {
+    Timeout timeout(get_virtual_ticker_data());
+    const timestamp_t delay = 1000000;
+    timestamp_t start = virtual_ticker_read();
+
+    pair_lp();
+    fired = 0;
+    timeout.attach_us(on_fire, YOTTA_CFG_MBED_DRIVERS_LP_TICKER_THRESHOLD_US - 1);
+    TEST_ASSERT_EQUAL_UINT32(1, us_queue_length());
+    TEST_ASSERT_EQUAL_UINT32(0, lp_queue_length());
+    TEST_ASSERT_TRUE(get_virtual_lp_ticker_data()->queue->event_handler == NULL);
+    timeout.detach();
+
+    timeout.attach_us(on_fire, delay);
+    TEST_ASSERT_TRUE(get_virtual_lp_ticker_data()->queue->event_handler == &TimerEvent::irq);
+    TEST_ASSERT_EQUAL_UINT32(0, us_queue_length());
+    TEST_ASSERT_EQUAL_UINT32(1, lp_queue_length());
+    virtual_ticker_advance(delay - lp_margin(delay) - 1);
+    TEST_ASSERT_EQUAL_UINT32(1, lp_queue_length());
+    virtual_ticker_advance(1);
+    TEST_ASSERT_EQUAL_UINT32(1, us_queue_length());
+    TEST_ASSERT_EQUAL_UINT32(0, lp_queue_length());
+    virtual_ticker_advance(lp_margin(delay) - 1);
+    TEST_ASSERT_EQUAL_INT(0, fired);
+    virtual_ticker_advance(1);
+    TEST_ASSERT_EQUAL_INT(1, fired);
+    TEST_ASSERT_EQUAL_UINT32(start + delay, fired_at);
+    unpair_lp();
+}
+
+// A drifting low power ticker still hands the event over before its
+// deadline, which is then only missed by the drift
+void test_case_lp_drift() {
+    Timeout timeout(get_virtual_ticker_data());
+    const timestamp_t delay = 10000000;
+    const int32_t drifts[] = {-500, 500};
+
+    pair_lp();
+    for (int i = 0; i < 2; i++) {
+        virtual_lp_ticker_set_drift(drifts[i]);
+        timestamp_t start = virtual_ticker_read();
+        fired = 0;
+        timeout.attach_us(on_fire, delay);
+        virtual_ticker_advance(delay - 1);
+        TEST_ASSERT_EQUAL_UINT32(0, lp_queue_length());
+        virtual_ticker_advance(delay / 1000);
+        TEST_ASSERT_EQUAL_INT(1, fired);
+        // late if the low power ticker is slow, early if it is fast
+        int error = (int)(fired_at - (start + delay));
+        TEST_ASSERT_TRUE(drifts[i] < 0 ? error > 0 : error < 0);
+        TEST_ASSERT_INT_WITHIN(delay / 2000 + 2, 0, error);
+    }
+    unpair_lp();
+}
+
+// Detaching on the low power ticker, after the handover, and from a low
+// power ticker handler running in the same batch as the handover, before
+// and after it
+void test_case_lp_remove() {
+    Timeout timeout(get_virtual_ticker_data());
+    Timeout remover(get_virtual_lp_ticker_data());
+    const timestamp_t delay = 1000000;
+
+    pair_lp();
+    fired = 0;
+    far_timeout = &timeout;
+    timeout.attach_us(on_fire, delay);
+    virtual_ticker_advance(delay / 2);
+    timeout.detach();
+    TEST_ASSERT_EQUAL_UINT32(0, lp_queue_length());
+
+    timeout.attach_us(on_fire, delay);
+    virtual_ticker_advance(delay - lp_margin(delay));
+    TEST_ASSERT_EQUAL_UINT32(1, us_queue_length());
+    timeout.detach();
+    TEST_ASSERT_EQUAL_UINT32(0, us_queue_length());
+
+    for (int remover_first = 0; remover_first < 2; remover_first++) {
+        timestamp_t handover = delay - lp_margin(delay);
+        if (remover_first) {
+            remover.attach_us(detach_far, handover);
+            timeout.attach_us(on_fire, delay);
+        } else {
+            timeout.attach_us(on_fire, delay);
+            remover.attach_us(detach_far, handover);
+        }
+        virtual_ticker_advance(handover);
+        TEST_ASSERT_EQUAL_UINT32(0, us_queue_length());
+        TEST_ASSERT_EQUAL_UINT32(0, lp_queue_length());
+        TEST_ASSERT_EQUAL_UINT32(virtual_ticker_read(), fired_at);
+    }
+
+    virtual_ticker_advance(2 * delay);
+    TEST_ASSERT_EQUAL_INT(0, fired);
+    unpair_lp();
+}
+
+// A deferred Ticker only queues its calls from the interrupt, and Tickers
+// on the low power ticker queue theirs in the same queue
+void test_case_deferred_delivery() {
+    Ticker ticker(get_virtual_ticker_data());
+    Ticker lp_ticker(get_virtual_lp_ticker_data());
+    uint32_t wakeups = CompletionSource::wakeups();
+
+    fired = 0;
+    lp_fired = 0;
+    ticker.set_deferred(true);
+    lp_ticker.set_deferred(true);
+    ticker.attach_us(on_fire, DEFERRED_PERIOD);
+    lp_ticker.attach_us(on_lp_fire, DEFERRED_PERIOD);
+    virtual_ticker_advance(DEFERRED_PERIOD);
+    TEST_ASSERT_EQUAL_INT(0, fired);
+    TEST_ASSERT_EQUAL_INT(0, lp_fired);
+    TEST_ASSERT_EQUAL_UINT32(1, wakeups_since(wakeups));
+    virtual_ticker_advance(DEFERRED_PERIOD);
+    TEST_ASSERT_EQUAL_UINT32(1, wakeups_since(wakeups));
+    CompletionTask::run();
+    TEST_ASSERT_EQUAL_INT(2, fired);
+    TEST_ASSERT_EQUAL_INT(2, lp_fired);
+
+    // detaching drops the calls still queued
+    virtual_ticker_advance(DEFERRED_PERIOD);
+    ticker.detach();
+    lp_ticker.set_deferred(false);
+    TEST_ASSERT_EQUAL_UINT32(2, wakeups_since(wakeups));
+    CompletionTask::run();
+    TEST_ASSERT_EQUAL_INT(2, fired);
+    TEST_ASSERT_EQUAL_INT(2, lp_fired);
+    virtual_ticker_advance(DEFERRED_PERIOD);
+    TEST_ASSERT_EQUAL_INT(3, lp_fired);
+    TEST_ASSERT_EQUAL_UINT32(2, wakeups_since(wakeups));
+    lp_ticker.detach();
+}
+
+// The completion task runs 8 calls, then is posted again for the others
+void test_case_deferred_batch() {
+    Ticker ticker(get_virtual_ticker_data());
+    uint32_t wakeups = CompletionSource::wakeups();
+
+    fired = 0;
+    ticker.set_deferred(true);
+    ticker.attach_us(on_fire, DEFERRED_PERIOD);
+    for (int i = 0; i < 12; i++) {
+        virtual_ticker_advance(DEFERRED_PERIOD);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, wakeups_since(wakeups));
+    CompletionTask::run();
+    TEST_ASSERT_EQUAL_INT(8, fired);
+    TEST_ASSERT_EQUAL_UINT32(2, wakeups_since(wakeups));
+    CompletionTask::run();
+    TEST_ASSERT_EQUAL_INT(12, fired);
+    TEST_ASSERT_EQUAL_UINT32(2, wakeups_since(wakeups));
+    ticker.detach();
+}
+
+// The calls which don't fit in the queue are dropped and counted
+void test_case_deferred_overflow() {
+    Ticker ticker(get_virtual_ticker_data());
+    const int size = YOTTA_CFG_MBED_DRIVERS_TICKER_DEFERRED_QUEUE_SIZE;
+    uint32_t overflows = Ticker::deferred_overflows();
+
+    fired = 0;
+    ticker.set_deferred(true);
+    ticker.attach_us(on_fire, DEFERRED_PERIOD);
+    for (int i = 0; i < size + 3; i++) {
+        virtual_ticker_advance(DEFERRED_PERIOD);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, Ticker::deferred_overflows() - overflows);
+    for (int i = 0; i < size; i += 8) {
+        CompletionTask::run();
+    }
+    TEST_ASSERT_EQUAL_INT(size, fired);
+
+    // the queue takes calls again
+    virtual_ticker_advance(DEFERRED_PERIOD);
+    CompletionTask::run();
+    TEST_ASSERT_EQUAL_INT(size + 1, fired);
+    TEST_ASSERT_EQUAL_UINT32(3, Ticker::deferred_overflows() - overflows);
+    ticker.detach();
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("Virtual ticker: Timeout", test_case_timeout, greentea_failure_handler),
+    Case("Virtual ticker: Ticker", test_case_ticker, greentea_failure_handler),
+    Case("Virtual ticker: 1M re-armed Timeouts", test_case_stress, greentea_failure_handler),
+    Case("Ticker overrun: catch up", test_case_overrun_catch_up, greentea_failure_handler),
+    Case("Ticker overrun: skip", test_case_overrun_skip, greentea_failure_handler),
+    Case("Ticker overrun: realign", test_case_overrun_realign, greentea_failure_handler),
+    Case("Timer wheel: deadlines on every level", test_case_wheel_levels, greentea_failure_handler),
+    Case("Timer wheel: cancellation", test_case_wheel_cancel, greentea_failure_handler),
+    Case("Timer wheel: random deadlines", test_case_wheel_random, greentea_failure_handler),
+    Case("Timer slack: overlapping windows", test_case_slack_overlapping, greentea_failure_handler),
+    Case("Timer slack: separate windows", test_case_slack_separate, greentea_failure_handler),
+    Case("Timer slack: window across the wrap", test_case_slack_wrap, greentea_failure_handler),
+    Case("64-bit time: several wraps", test_case_us64_wraps, greentea_failure_handler),
+    Case("64-bit time: keepalive", test_case_us64_keepalive, greentea_failure_handler),
+    Case("64-bit time: far deadline", test_case_us64_far_deadline, greentea_failure_handler),
+    Case("64-bit time: Timer past 35 minutes", test_case_us64_timer, greentea_failure_handler),
+    // these set up the low power ticker, whose keepalive interrupts then add
+    // to the interrupts run by virtual_ticker_advance()
+    Case("Low power ticker: migration", test_case_lp_migration, greentea_failure_handler),
+    Case("Low power ticker: drift", test_case_lp_drift, greentea_failure_handler),
+    Case("Low power ticker: removal around the handover", test_case_lp_remove, greentea_failure_handler),
+    Case("Deferred Ticker: delivery", test_case_deferred_delivery, greentea_failure_handler),
+    Case("Deferred Ticker: batches", test_case_deferred_batch, greentea_failure_handler),
+    Case("Deferred Ticker: overflow", test_case_deferred_overflow, greentea_failure_handler),
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(60, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <limits.h>
+#include "mbed-drivers/mbed.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+
+using namespace utest::v1;
+
+namespace {
+const int ROUNDS = 20;
+// How much later than a busy-wait a sleeping wait may end
+const int MAX_EXTRA_LATE_US = 20;
+}
+
+// Average and worst time by which wait_us(us) overshoots, in microseconds
+void measure(int us, int &average, int &worst) {
+    Timer timer;
+    int total = 0;
+
+    worst = 0;
+    timer.start();
+    for (int i = 0; i < ROUNDS; i++) {
+        timer.reset();
+        wait_us(us);
+        int late = timer.read_us() - us;
+        TEST_ASSERT_TRUE(late >= 0);
+        total += late;
+        if (late > worst) {
+            worst = late;
+        }
+    }
+    average = total / ROUNDS;
+}
+
+void test_case_calibrate() {
+    uint32_t threshold = wait_calibrate();
+    greentea_send_kv("spin_threshold_us", threshold);
+    TEST_ASSERT_EQUAL_UINT32(threshold, wait_get_spin_threshold_us());
+}
+
+template <int US>
+void test_case_accuracy() {
+    char key[32];
+    int spin_average, spin_worst, sleep_average, sleep_worst;
+    uint32_t threshold = wait_get_spin_threshold_us();
+
+    wait_set_spin_threshold_us(UINT_MAX);
+    measure(US, spin_average, spin_worst);
+    wait_set_spin_threshold_us(threshold);
+    measure(US, sleep_average, sleep_worst);
+
+    snprintf(key, sizeof(key), "spin_late_us_%d", US);
+    greentea_send_kv(key, spin_average);
+    snprintf(key, sizeof(key), "sleep_late_us_%d", US);
+    greentea_send_kv(key, sleep_average);
+    TEST_ASSERT_TRUE(sleep_worst <= spin_worst + MAX_EXTRA_LATE_US);
+}
+
+status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("Wait: calibrate", test_case_calibrate, greentea_failure_handler),
+    Case("Wait: 100us accuracy", test_case_accuracy<100>, greentea_failure_handler),
+    Case("Wait: 1ms accuracy", test_case_accuracy<1000>, greentea_failure_handler),
+    Case("Wait: 10ms accuracy", test_case_accuracy<10000>, greentea_failure_handler),
+};
+
+status_t greentea_test_setup(const size_t number_of_cases) {
+    GREENTEA_SETUP(20, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+void app_start(int, char*[]) {
+    Harness::run(specification);
+}